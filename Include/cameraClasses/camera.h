@@ -102,6 +102,14 @@ public:
         updateCameraVectors();
     }
 
+    // sets the Euler angles directly (e.g. from a scripted camera path) and updates the camera vectors
+    void SetOrientation(float yaw, float pitch)
+    {
+        Yaw = yaw;
+        Pitch = pitch;
+        updateCameraVectors();
+    }
+
     // processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
     void ProcessMouseScroll(float yoffset)
     {
@@ -0,0 +1,50 @@
+#pragma once
+#ifndef FILE_SYSTEM_H
+#define FILE_SYSTEM_H
+
+#include <cstdint>
+#include <string>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+// Size and modification time of a file: the caches rebuild an entry when those of its source change
+struct FileStamp
+{
+    std::uint64_t Size;
+    std::int64_t Modified;
+};
+
+// false when the file does not exist
+inline bool fileStamp(const std::string& path, FileStamp& stamp)
+{
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0)
+        return false;
+    stamp.Size = (std::uint64_t)status.st_size;
+    stamp.Modified = (std::int64_t)status.st_mtime;
+    return true;
+}
+
+// creates one directory level; nothing happens when it exists
+inline void makeDirectory(const char* path)
+{
+#ifdef _WIN32
+    _mkdir(path);
+#else
+    mkdir(path, 0755);
+#endif
+}
+
+// 64-bit FNV-1a, continuing from `hash`
+inline std::uint64_t fnv1a(const void* bytes, size_t length, std::uint64_t hash = 14695981039346656037ull)
+{
+    const std::uint8_t* data = static_cast<const std::uint8_t*>(bytes);
+    for (size_t i = 0; i < length; i++)
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    return hash;
+}
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+#ifndef PPM_IMAGE_H
+#define PPM_IMAGE_H
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// writes 8-bit RGB pixels, rows ordered top to bottom, as a binary PPM (P6) image
+inline bool writePpm(const std::string& path, int width, int height, const unsigned char* rgbPixels)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cout << "ERROR::PPM_IMAGE::CANNOT_WRITE: " << path << std::endl;
+        return false;
+    }
+    file << "P6\n" << width << " " << height << "\n255\n";
+    file.write(reinterpret_cast<const char*>(rgbPixels), (std::streamsize)width * height * 3);
+    return (bool)file;
+}
+#endif
@@ -0,0 +1,111 @@
+#pragma once
+#ifndef MESH_BUFFERS_H
+#define MESH_BUFFERS_H
+
+#include <glad/glad.h>
+
+#include <meshClasses/mesh_data.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The vertex and index buffers of a mesh. Indices are uploaded as 16-bit values whenever the mesh has at most
+// 65536 vertices. A vertex array gets the buffers with BindAttributes() and draws them with Draw().
+class MeshBuffers
+{
+public:
+    explicit MeshBuffers(const MeshData& mesh)
+    {
+        if (mesh.Vertices.size() <= 65536)
+        {
+            std::vector<std::uint16_t> shortIndices(mesh.Indices.begin(), mesh.Indices.end());
+            upload(mesh.Vertices.data(), (unsigned int)mesh.Vertices.size(), shortIndices.data(), (unsigned int)shortIndices.size(), GL_UNSIGNED_SHORT);
+        }
+        else
+        {
+            upload(mesh.Vertices.data(), (unsigned int)mesh.Vertices.size(), mesh.Indices.data(), (unsigned int)mesh.Indices.size(), GL_UNSIGNED_INT);
+        }
+    }
+
+    // from memory already in the buffer layout, e.g. a MappedMesh: nothing is converted
+    MeshBuffers(const PackedVertex* vertices, unsigned int vertexCount, const void* indices, unsigned int indexCount, GLenum indexType)
+    {
+        upload(vertices, vertexCount, indices, indexCount, indexType);
+    }
+
+    MeshBuffers(const MeshBuffers&) = delete;
+    MeshBuffers& operator=(const MeshBuffers&) = delete;
+
+    ~MeshBuffers()
+    {
+        glDeleteBuffers(1, &vertexBuffer);
+        glDeleteBuffers(1, &indexBuffer);
+    }
+
+    // into the bound vertex array: positions at location 0, and with surfaceAttributes normals at 1 and texture coordinates at 2
+    void BindAttributes(bool surfaceAttributes = true) const
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Position));
+        glEnableVertexAttribArray(0);
+        if (!surfaceAttributes)
+            return;
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoord));
+        glEnableVertexAttribArray(2);
+    }
+
+    void Draw() const
+    {
+        glDrawElements(GL_TRIANGLES, (GLsizei)indexCount, indexType, (void*)0);
+    }
+
+    void DrawInstanced(unsigned int instanceCount) const
+    {
+        glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)indexCount, indexType, (void*)0, (GLsizei)instanceCount);
+    }
+
+    unsigned int VertexCount() const
+    {
+        return vertexCount;
+    }
+
+    unsigned int IndexCount() const
+    {
+        return indexCount;
+    }
+
+    GLenum IndexType() const
+    {
+        return indexType;
+    }
+
+private:
+    unsigned int vertexBuffer;
+    unsigned int indexBuffer;
+    unsigned int vertexCount;
+    unsigned int indexCount;
+    GLenum indexType;
+
+    void upload(const PackedVertex* vertices, unsigned int newVertexCount, const void* indices, unsigned int newIndexCount, GLenum newIndexType)
+    {
+        vertexCount = newVertexCount;
+        indexCount = newIndexCount;
+        indexType = newIndexType;
+        glGenBuffers(1, &vertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexCount * sizeof(PackedVertex), vertices, GL_STATIC_DRAW);
+
+        // the element array binding belongs to the vertex array: keep the current one out of it
+        glBindVertexArray(0);
+        glGenBuffers(1, &indexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(indexCount * indexSize), indices, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+};
+#endif
@@ -0,0 +1,89 @@
+#pragma once
+#ifndef MESH_DATA_H
+#define MESH_DATA_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+
+// 20 bytes instead of 32: the normal as signed normalized 10:10:10:2 (GL_INT_2_10_10_10_REV) and the
+// texture coordinates as two half floats; positions stay full floats.
+struct PackedVertex
+{
+    float Position[3];
+    std::uint32_t Normal;
+    std::uint32_t TexCoord;
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must stay tightly packed");
+
+// An indexed triangle list
+struct MeshData
+{
+    std::vector<PackedVertex> Vertices;
+    std::vector<std::uint32_t> Indices;
+};
+
+inline PackedVertex packVertex(const float* position, const float* normal, const float* texCoord)
+{
+    PackedVertex vertex;
+    std::memcpy(vertex.Position, position, sizeof(vertex.Position));
+    vertex.Normal = glm::packSnorm3x10_1x2(glm::vec4(normal[0], normal[1], normal[2], 0.0f));
+    vertex.TexCoord = glm::packHalf2x16(glm::vec2(texCoord[0], texCoord[1]));
+    return vertex;
+}
+
+// centers the mesh on the origin and scales it uniformly so that its largest side is 1, like the cube
+inline void fitToUnitCube(MeshData& mesh)
+{
+    if (mesh.Vertices.empty())
+        return;
+    glm::vec3 low = glm::make_vec3(mesh.Vertices[0].Position), high = low;
+    for (const PackedVertex& vertex : mesh.Vertices)
+    {
+        low = glm::min(low, glm::make_vec3(vertex.Position));
+        high = glm::max(high, glm::make_vec3(vertex.Position));
+    }
+    glm::vec3 center = (low + high) * 0.5f;
+    glm::vec3 size = high - low;
+    float largestSide = std::max(size.x, std::max(size.y, size.z));
+    float scale = largestSide > 0.0f ? 1.0f / largestSide : 1.0f;
+    for (PackedVertex& vertex : mesh.Vertices)
+    {
+        for (int i = 0; i < 3; i++)
+            vertex.Position[i] = (vertex.Position[i] - center[i]) * scale;
+    }
+}
+
+// Indexes a non-indexed triangle list of position, normal and texture coordinates (8 floats from each
+// `stride` floats): vertices equal once packed are stored once, in order of first use.
+inline MeshData buildIndexedMesh(const float* vertices, unsigned int vertexCount, unsigned int stride)
+{
+    struct PackedLess
+    {
+        bool operator()(const PackedVertex& a, const PackedVertex& b) const
+        {
+            return std::memcmp(&a, &b, sizeof(PackedVertex)) < 0;
+        }
+    };
+    std::map<PackedVertex, std::uint32_t, PackedLess> uniqueVertices;
+
+    MeshData mesh;
+    mesh.Indices.reserve(vertexCount);
+    for (unsigned int i = 0; i < vertexCount; i++)
+    {
+        const float* source = vertices + (size_t)i * stride;
+        PackedVertex vertex = packVertex(source, source + 3, source + 6);
+        auto inserted = uniqueVertices.insert(std::make_pair(vertex, (std::uint32_t)mesh.Vertices.size()));
+        if (inserted.second)
+            mesh.Vertices.push_back(vertex);
+        mesh.Indices.push_back(inserted.first->second);
+    }
+    return mesh;
+}
+#endif
@@ -0,0 +1,212 @@
+#pragma once
+#ifndef MESH_FILE_H
+#define MESH_FILE_H
+
+#include <glad/glad.h>
+
+#include <fileClasses/file_system.h>
+#include <fileClasses/mapped_file.h>
+#include <meshClasses/mesh_data.h>
+#include <meshClasses/mesh_optimizer.h>
+#include <meshClasses/obj_reader.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Binary mesh file (.nlmesh): a header followed by the vertex block and the index block, each starting on a
+// 16-byte boundary and laid out exactly as the GL buffers (PackedVertex, then 16-bit indices when the mesh has
+// at most 65536 vertices, 32-bit otherwise). A MappedMesh maps the file and its blocks go to glBufferData as
+// they are: loading costs the I/O and nothing else.
+class MeshFile
+{
+public:
+    static const std::uint32_t MAGIC = 0x534d4c4eu; // "NLMS"
+    static const std::uint32_t FORMAT_VERSION = 2;
+    static const std::uint64_t BLOCK_ALIGNMENT = 16;
+
+    struct Header
+    {
+        std::uint32_t Magic;
+        std::uint32_t FormatVersion;
+        std::uint32_t VertexCount;
+        std::uint32_t VertexStride;
+        std::uint32_t IndexCount;
+        std::uint32_t IndexSize;      // 2 or 4 bytes
+        std::uint64_t VertexOffset;   // from the start of the file
+        std::uint64_t IndexOffset;
+        std::uint64_t SourceSize;     // stamp of the source asset at conversion time
+        std::int64_t SourceModified;
+        float BoundsMin[3];
+        float BoundsMax[3];
+    };
+
+    static bool Write(const std::string& path, const MeshData& mesh, const FileStamp& sourceStamp)
+    {
+        bool shortIndices = mesh.Vertices.size() <= 65536;
+        Header header = {};
+        header.Magic = MAGIC;
+        header.FormatVersion = FORMAT_VERSION;
+        header.VertexCount = (std::uint32_t)mesh.Vertices.size();
+        header.VertexStride = sizeof(PackedVertex);
+        header.IndexCount = (std::uint32_t)mesh.Indices.size();
+        header.IndexSize = shortIndices ? 2 : 4;
+        header.VertexOffset = alignUp(sizeof(Header));
+        header.IndexOffset = alignUp(header.VertexOffset + (std::uint64_t)header.VertexCount * header.VertexStride);
+        header.SourceSize = sourceStamp.Size;
+        header.SourceModified = sourceStamp.Modified;
+        for (int i = 0; i < 3; i++)
+        {
+            header.BoundsMin[i] = mesh.Vertices.empty() ? 0.0f : mesh.Vertices[0].Position[i];
+            header.BoundsMax[i] = header.BoundsMin[i];
+        }
+        for (const PackedVertex& vertex : mesh.Vertices)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                header.BoundsMin[i] = std::min(header.BoundsMin[i], vertex.Position[i]);
+                header.BoundsMax[i] = std::max(header.BoundsMax[i], vertex.Position[i]);
+            }
+        }
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR::MESH_FILE::CANNOT_WRITE: " << path << std::endl;
+            return false;
+        }
+        static const char zeros[BLOCK_ALIGNMENT] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(zeros, (std::streamsize)(header.VertexOffset - sizeof(header)));
+        file.write(reinterpret_cast<const char*>(mesh.Vertices.data()), (std::streamsize)(mesh.Vertices.size() * sizeof(PackedVertex)));
+        file.write(zeros, (std::streamsize)(header.IndexOffset - (header.VertexOffset + (std::uint64_t)header.VertexCount * header.VertexStride)));
+        if (shortIndices)
+        {
+            std::vector<std::uint16_t> indices(mesh.Indices.begin(), mesh.Indices.end());
+            file.write(reinterpret_cast<const char*>(indices.data()), (std::streamsize)(indices.size() * sizeof(std::uint16_t)));
+        }
+        else
+        {
+            file.write(reinterpret_cast<const char*>(mesh.Indices.data()), (std::streamsize)(mesh.Indices.size() * sizeof(std::uint32_t)));
+        }
+        return (bool)file;
+    }
+
+    // OBJ -> .nlmesh, the mesh fitted into the unit cube it replaces in the scene and reordered by the MeshOptimizer
+    static bool Convert(const std::string& sourcePath, const std::string& outputPath)
+    {
+        FileStamp stamp;
+        MeshData mesh;
+        if (!fileStamp(sourcePath, stamp) || !ObjReader::Read(sourcePath, mesh))
+            return false;
+        fitToUnitCube(mesh);
+        VertexCacheStats before, after;
+        MeshOptimizer::Optimize(mesh, before, after);
+        std::cout << "Optimized " << sourcePath << ": ACMR " << before.ACMR << " -> " << after.ACMR
+            << ", ATVR " << before.ATVR << " -> " << after.ATVR << std::endl;
+        return Write(outputPath, mesh, stamp);
+    }
+
+    // the .nlmesh to load for a source asset: .nlmesh files as they are, other files converted once into
+    // mesh_cache/ and converted again when they change; empty on failure
+    static std::string Import(const std::string& sourcePath)
+    {
+        if (sourcePath.size() >= 7 && sourcePath.compare(sourcePath.size() - 7, 7, ".nlmesh") == 0)
+            return sourcePath;
+
+        FileStamp stamp;
+        if (!fileStamp(sourcePath, stamp))
+        {
+            std::cout << "ERROR::MESH_FILE::SOURCE_NOT_FOUND: " << sourcePath << std::endl;
+            return std::string();
+        }
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.nlmesh", (unsigned long long)fnv1a(sourcePath.data(), sourcePath.size()));
+        std::string cachedPath = std::string("mesh_cache/") + name;
+        {
+            MappedFile cached(cachedPath);
+            Header header;
+            if (cached.IsOpen() && cached.Size() >= sizeof(Header))
+            {
+                std::memcpy(&header, cached.Data(), sizeof(header));
+                if (header.Magic == MAGIC && header.FormatVersion == FORMAT_VERSION
+                    && header.SourceSize == stamp.Size && header.SourceModified == stamp.Modified)
+                    return cachedPath;
+            }
+        }
+        makeDirectory("mesh_cache");
+        return Convert(sourcePath, cachedPath) ? cachedPath : std::string();
+    }
+
+private:
+    static std::uint64_t alignUp(std::uint64_t value)
+    {
+        return (value + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT;
+    }
+};
+
+// A .nlmesh file mapped in memory; IsOpen() is false when the file is missing or malformed
+class MappedMesh
+{
+public:
+    explicit MappedMesh(const std::string& path) : file(path), valid(false)
+    {
+        if (!file.IsOpen() || file.Size() < sizeof(MeshFile::Header))
+        {
+            std::cout << "ERROR::MESH_FILE::NOT_READ: " << path << std::endl;
+            return;
+        }
+        std::memcpy(&header, file.Data(), sizeof(header));
+        valid = header.Magic == MeshFile::MAGIC && header.FormatVersion == MeshFile::FORMAT_VERSION
+            && header.VertexStride == sizeof(PackedVertex) && (header.IndexSize == 2 || header.IndexSize == 4)
+            && header.VertexOffset + (std::uint64_t)header.VertexCount * header.VertexStride <= file.Size()
+            && header.IndexOffset + (std::uint64_t)header.IndexCount * header.IndexSize <= file.Size();
+        if (!valid)
+            std::cout << "ERROR::MESH_FILE::INVALID: " << path << std::endl;
+    }
+
+    bool IsOpen() const
+    {
+        return valid;
+    }
+
+    const PackedVertex* Vertices() const
+    {
+        return reinterpret_cast<const PackedVertex*>(file.Data() + header.VertexOffset);
+    }
+
+    unsigned int VertexCount() const
+    {
+        return header.VertexCount;
+    }
+
+    const void* Indices() const
+    {
+        return file.Data() + header.IndexOffset;
+    }
+
+    unsigned int IndexCount() const
+    {
+        return header.IndexCount;
+    }
+
+    GLenum IndexType() const
+    {
+        return header.IndexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    }
+
+    const MeshFile::Header& FileHeader() const
+    {
+        return header;
+    }
+
+private:
+    MappedFile file;
+    MeshFile::Header header;
+    bool valid;
+};
+#endif
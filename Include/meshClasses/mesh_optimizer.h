@@ -0,0 +1,350 @@
+#pragma once
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <meshClasses/mesh_data.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// Post-transform vertex cache efficiency of an index buffer, measured on a FIFO cache of `CacheSize` entries.
+// ACMR: vertex shader invocations per triangle (3 at worst, about 0.5 at best on a regular grid).
+// ATVR: vertex shader invocations per vertex (1 is ideal).
+struct VertexCacheStats
+{
+    static const unsigned int CacheSize = 16;
+    float ACMR;
+    float ATVR;
+};
+
+// Import-time reordering of a mesh for the GPU, in three passes:
+// - OptimizeVertexCache(): triangle order for the post-transform cache, Forsyth's "linear-speed vertex cache
+//   optimisation" (greedy, each step emits the triangle whose vertices score best in a simulated LRU cache);
+// - OptimizeOverdraw(): splits that order into clusters at the points where the cache starts cold anyway, and
+//   draws outward-facing clusters first so that they occlude the rest, as long as ACMR grows by at most
+//   `threshold`; the fragment shader's three texture-dependent lighting terms then run on fewer hidden fragments;
+// - OptimizeVertexFetch(): vertices renumbered in order of first use, so that fetches walk the vertex buffer forward.
+class MeshOptimizer
+{
+public:
+    static VertexCacheStats AnalyzeVertexCache(const std::vector<std::uint32_t>& indices, size_t vertexCount)
+    {
+        std::vector<std::uint32_t> timestamps(vertexCount, 0);
+        std::uint32_t time = VertexCacheStats::CacheSize + 1;
+        size_t misses = 0;
+        for (std::uint32_t index : indices)
+        {
+            // a vertex is cached when it entered the FIFO less than CacheSize misses ago
+            if (time - timestamps[index] > VertexCacheStats::CacheSize)
+            {
+                timestamps[index] = time++;
+                misses++;
+            }
+        }
+        VertexCacheStats stats;
+        stats.ACMR = indices.empty() ? 0.0f : (float)misses / (indices.size() / 3);
+        stats.ATVR = vertexCount == 0 ? 0.0f : (float)misses / vertexCount;
+        return stats;
+    }
+
+    static void OptimizeVertexCache(std::vector<std::uint32_t>& indices, size_t vertexCount)
+    {
+        const int cacheSize = FORSYTH_CACHE_SIZE;
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+            return;
+
+        // triangles around each vertex
+        std::vector<std::uint32_t> adjacencyOffsets(vertexCount + 1, 0), remainingValence(vertexCount, 0);
+        for (std::uint32_t index : indices)
+            remainingValence[index]++;
+        for (size_t v = 0; v < vertexCount; v++)
+            adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingValence[v];
+        std::vector<std::uint32_t> adjacency(indices.size()), fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            for (int k = 0; k < 3; k++)
+                adjacency[fill[indices[t * 3 + k]]++] = (std::uint32_t)t;
+        }
+
+        std::vector<int> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScores(vertexCount), triangleScores(triangleCount, 0.0f);
+        for (size_t v = 0; v < vertexCount; v++)
+            vertexScores[v] = vertexScore(-1, remainingValence[v]);
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            for (int k = 0; k < 3; k++)
+                triangleScores[t] += vertexScores[indices[t * 3 + k]];
+        }
+
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<std::uint32_t> output;
+        output.reserve(indices.size());
+        std::vector<std::uint32_t> cache, nextCache;
+        size_t scanCursor = 0;
+        long long bestTriangle = -1;
+        for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+        {
+            if (bestTriangle < 0)
+            {
+                // nothing left around the cache: restart from the next triangle in input order
+                while (emitted[scanCursor])
+                    scanCursor++;
+                bestTriangle = (long long)scanCursor;
+            }
+            size_t triangle = (size_t)bestTriangle;
+            emitted[triangle] = true;
+            const std::uint32_t* corners = &indices[triangle * 3];
+            output.insert(output.end(), corners, corners + 3);
+
+            // the triangle's vertices move to the front of the cache (once each, a degenerate triangle repeats one),
+            // the others keep their order
+            nextCache.clear();
+            for (int k = 0; k < 3; k++)
+            {
+                if (std::find(nextCache.begin(), nextCache.end(), corners[k]) == nextCache.end())
+                    nextCache.push_back(corners[k]);
+            }
+            for (std::uint32_t vertex : cache)
+            {
+                if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2])
+                    nextCache.push_back(vertex);
+            }
+            for (int k = 0; k < 3; k++)
+            {
+                std::uint32_t vertex = corners[k];
+                // remove the triangle from the vertex's remaining list
+                std::uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+                std::uint32_t* end = begin + remainingValence[vertex];
+                *std::find(begin, end, (std::uint32_t)triangle) = *(end - 1);
+                remainingValence[vertex]--;
+            }
+
+            // rescore the vertices that are (or just were) in the cache, and the triangles around them
+            for (size_t position = 0; position < nextCache.size(); position++)
+            {
+                std::uint32_t vertex = nextCache[position];
+                int newPosition = position < (size_t)cacheSize ? (int)position : -1;
+                cachePosition[vertex] = newPosition;
+                float score = vertexScore(newPosition, remainingValence[vertex]);
+                float delta = score - vertexScores[vertex];
+                vertexScores[vertex] = score;
+                for (std::uint32_t i = 0; i < remainingValence[vertex]; i++)
+                    triangleScores[adjacency[adjacencyOffsets[vertex] + i]] += delta;
+            }
+
+            // then, with every score final, pick the best of those triangles
+            bestTriangle = -1;
+            float bestScore = -1.0f;
+            for (std::uint32_t vertex : nextCache)
+            {
+                for (std::uint32_t i = 0; i < remainingValence[vertex]; i++)
+                {
+                    std::uint32_t neighbor = adjacency[adjacencyOffsets[vertex] + i];
+                    if (triangleScores[neighbor] > bestScore)
+                    {
+                        bestScore = triangleScores[neighbor];
+                        bestTriangle = (long long)neighbor;
+                    }
+                }
+            }
+            if (nextCache.size() > (size_t)cacheSize)
+                nextCache.resize(cacheSize);
+            cache.swap(nextCache);
+        }
+        indices.swap(output);
+    }
+
+    static void OptimizeOverdraw(std::vector<std::uint32_t>& indices, const std::vector<PackedVertex>& vertices, float threshold = 1.05f)
+    {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2)
+            return;
+        VertexCacheStats before = AnalyzeVertexCache(indices, vertices.size());
+
+        // hard boundaries: triangles whose three vertices all miss the cache, where reordering costs nothing
+        std::vector<size_t> hardBoundaries;
+        {
+            std::vector<std::uint32_t> timestamps(vertices.size(), 0);
+            std::uint32_t time = VertexCacheStats::CacheSize + 1;
+            for (size_t t = 0; t < triangleCount; t++)
+            {
+                int misses = 0;
+                for (int k = 0; k < 3; k++)
+                {
+                    std::uint32_t index = indices[t * 3 + k];
+                    if (time - timestamps[index] > VertexCacheStats::CacheSize)
+                    {
+                        timestamps[index] = time++;
+                        misses++;
+                    }
+                }
+                if (t == 0 || misses == 3)
+                    hardBoundaries.push_back(t);
+            }
+        }
+        hardBoundaries.push_back(triangleCount);
+
+        // soft boundaries: within a hard cluster, split as soon as the part since the last split, started on a cold
+        // cache, is within `threshold` of the ACMR of the whole cluster
+        std::vector<size_t> boundaries;
+        for (size_t c = 0; c + 1 < hardBoundaries.size(); c++)
+        {
+            size_t begin = hardBoundaries[c], end = hardBoundaries[c + 1];
+            float clusterAcmr = rangeMisses(indices, begin, end) / (float)(end - begin);
+            boundaries.push_back(begin);
+            size_t partBegin = begin;
+            while (partBegin < end)
+            {
+                // grow the part until its ACMR is good enough
+                size_t partEnd = partBegin, misses = 0;
+                std::vector<std::uint32_t> cache;
+                while (partEnd < end)
+                {
+                    misses += triangleMisses(indices, partEnd++, cache);
+                    if (partEnd - partBegin >= MIN_CLUSTER_TRIANGLES && misses <= clusterAcmr * threshold * (partEnd - partBegin))
+                        break;
+                }
+                if (partEnd < end)
+                    boundaries.push_back(partEnd);
+                partBegin = partEnd;
+            }
+        }
+        boundaries.push_back(triangleCount);
+
+        // outward-facing clusters first: sort by how far the cluster lies along its own normal from the mesh center
+        glm::vec3 meshCenter(0.0f);
+        float meshArea = 0.0f;
+        std::vector<Cluster> clusters;
+        for (size_t c = 0; c + 1 < boundaries.size(); c++)
+        {
+            Cluster cluster = { boundaries[c], boundaries[c + 1], glm::vec3(0.0f), glm::vec3(0.0f), 0.0f, 0.0f };
+            for (size_t t = cluster.Begin; t < cluster.End; t++)
+            {
+                glm::vec3 a = glm::make_vec3(vertices[indices[t * 3]].Position);
+                glm::vec3 b = glm::make_vec3(vertices[indices[t * 3 + 1]].Position);
+                glm::vec3 d = glm::make_vec3(vertices[indices[t * 3 + 2]].Position);
+                glm::vec3 normal = glm::cross(b - a, d - a); // length: twice the area
+                float area = glm::length(normal);
+                cluster.Center += (a + b + d) * (area / 3.0f);
+                cluster.Normal += normal;
+                cluster.Area += area;
+            }
+            meshCenter += cluster.Center;
+            meshArea += cluster.Area;
+            clusters.push_back(cluster);
+        }
+        if (meshArea <= 0.0f)
+            return;
+        meshCenter /= meshArea;
+        for (Cluster& cluster : clusters)
+        {
+            glm::vec3 center = cluster.Area > 0.0f ? cluster.Center / cluster.Area : meshCenter;
+            float normalLength = glm::length(cluster.Normal);
+            cluster.SortKey = normalLength > 0.0f ? glm::dot(center - meshCenter, cluster.Normal / normalLength) : 0.0f;
+        }
+        std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.SortKey > b.SortKey; });
+
+        std::vector<std::uint32_t> reordered;
+        reordered.reserve(indices.size());
+        for (const Cluster& cluster : clusters)
+            reordered.insert(reordered.end(), indices.begin() + cluster.Begin * 3, indices.begin() + cluster.End * 3);
+        VertexCacheStats after = AnalyzeVertexCache(reordered, vertices.size());
+        if (after.ACMR <= before.ACMR * threshold)
+            indices.swap(reordered);
+    }
+
+    static void OptimizeVertexFetch(MeshData& mesh)
+    {
+        const std::uint32_t unused = 0xffffffffu;
+        std::vector<std::uint32_t> remap(mesh.Vertices.size(), unused);
+        std::vector<PackedVertex> vertices;
+        vertices.reserve(mesh.Vertices.size());
+        for (std::uint32_t& index : mesh.Indices)
+        {
+            if (remap[index] == unused)
+            {
+                remap[index] = (std::uint32_t)vertices.size();
+                vertices.push_back(mesh.Vertices[index]);
+            }
+            index = remap[index];
+        }
+        // vertices no triangle uses are dropped
+        mesh.Vertices.swap(vertices);
+    }
+
+    // the three passes, with the cache statistics before and after
+    static void Optimize(MeshData& mesh, VertexCacheStats& before, VertexCacheStats& after)
+    {
+        before = AnalyzeVertexCache(mesh.Indices, mesh.Vertices.size());
+        OptimizeVertexCache(mesh.Indices, mesh.Vertices.size());
+        OptimizeOverdraw(mesh.Indices, mesh.Vertices);
+        OptimizeVertexFetch(mesh);
+        after = AnalyzeVertexCache(mesh.Indices, mesh.Vertices.size());
+    }
+
+private:
+    static const int FORSYTH_CACHE_SIZE = 32;
+    // clusters smaller than this gain too little overdraw for the cache misses they cost
+    static const size_t MIN_CLUSTER_TRIANGLES = 64;
+
+    struct Cluster
+    {
+        size_t Begin, End; // triangle range
+        glm::vec3 Center;  // area-weighted sum of the triangle centers
+        glm::vec3 Normal;  // area-weighted sum of the triangle normals
+        float Area;
+        float SortKey;
+    };
+
+    // Forsyth's scoring: the three most recent vertices score a fixed amount (the triangle that uses them was
+    // just emitted), older ones decay with their cache position; vertices with few triangles left score higher
+    static float vertexScore(int cachePosition, std::uint32_t remainingValence)
+    {
+        if (remainingValence == 0)
+            return -1.0f;
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            if (cachePosition < 3)
+                score = 0.75f;
+            else
+                score = std::pow(1.0f - (cachePosition - 3) / (float)(FORSYTH_CACHE_SIZE - 3), 1.5f);
+        }
+        return score + 2.0f / std::sqrt((float)remainingValence);
+    }
+
+    // misses of one triangle in a FIFO cache small enough to search, for short ranges
+    static int triangleMisses(const std::vector<std::uint32_t>& indices, size_t triangle, std::vector<std::uint32_t>& cache)
+    {
+        int misses = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            std::uint32_t index = indices[triangle * 3 + k];
+            if (std::find(cache.begin(), cache.end(), index) != cache.end())
+                continue;
+            if (cache.size() == VertexCacheStats::CacheSize)
+                cache.erase(cache.begin());
+            cache.push_back(index);
+            misses++;
+        }
+        return misses;
+    }
+
+    // misses of the triangles [begin, end) on a cold cache
+    static size_t rangeMisses(const std::vector<std::uint32_t>& indices, size_t begin, size_t end)
+    {
+        std::vector<std::uint32_t> cache;
+        size_t misses = 0;
+        for (size_t t = begin; t < end; t++)
+            misses += triangleMisses(indices, t, cache);
+        return misses;
+    }
+};
+#endif
@@ -0,0 +1,255 @@
+#pragma once
+#ifndef OBJ_READER_H
+#define OBJ_READER_H
+
+#include <fileClasses/mapped_file.h>
+#include <meshClasses/mesh_data.h>
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reads the geometry of a Wavefront OBJ file: v, vt, vn and f statements (polygons are triangulated as fans,
+// negative indices count back from the last element); everything else (materials, groups, smoothing, lines)
+// is skipped. Every distinct position/texture/normal triple becomes one vertex. Corners without a normal get
+// the area-weighted average of the normals of the faces around their position.
+// The file is memory-mapped and parsed in place, without streams or string copies.
+class ObjReader
+{
+public:
+    static bool Read(const std::string& path, MeshData& mesh)
+    {
+        MappedFile file(path);
+        if (!file.IsOpen())
+        {
+            std::cout << "ERROR::OBJ_READER::FILE_NOT_READ: " << path << std::endl;
+            return false;
+        }
+
+        std::vector<glm::vec3> positions, normals;
+        std::vector<glm::vec2> texCoords;
+        std::vector<Corner> corners; // three per triangle
+        std::vector<Corner> polygon;
+
+        const char* cursor = reinterpret_cast<const char*>(file.Data());
+        const char* end = cursor + file.Size();
+        while (cursor < end)
+        {
+            skipSpaces(cursor, end);
+            const char* keyword = cursor;
+            while (cursor < end && !isSpace(*cursor) && *cursor != '\n')
+                cursor++;
+            size_t keywordLength = (size_t)(cursor - keyword);
+
+            if (keywordLength == 1 && keyword[0] == 'v')
+            {
+                glm::vec3 position;
+                for (int i = 0; i < 3; i++)
+                    position[i] = parseFloat(cursor, end);
+                positions.push_back(position);
+            }
+            else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 't')
+            {
+                glm::vec2 texCoord;
+                for (int i = 0; i < 2; i++)
+                    texCoord[i] = parseFloat(cursor, end);
+                texCoords.push_back(texCoord);
+            }
+            else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 'n')
+            {
+                glm::vec3 normal;
+                for (int i = 0; i < 3; i++)
+                    normal[i] = parseFloat(cursor, end);
+                normals.push_back(normal);
+            }
+            else if (keywordLength == 1 && keyword[0] == 'f')
+            {
+                polygon.clear();
+                Corner corner;
+                while (parseCorner(cursor, end, positions.size(), texCoords.size(), normals.size(), corner))
+                {
+                    if (corner.Position >= 0)
+                        polygon.push_back(corner);
+                }
+                for (size_t i = 2; i < polygon.size(); i++)
+                {
+                    corners.push_back(polygon[0]);
+                    corners.push_back(polygon[i - 1]);
+                    corners.push_back(polygon[i]);
+                }
+            }
+            skipLine(cursor, end);
+        }
+        if (corners.empty())
+        {
+            std::cout << "ERROR::OBJ_READER::NO_TRIANGLES: " << path << std::endl;
+            return false;
+        }
+
+        // normals of the corners that have none, from the faces around each position
+        std::vector<glm::vec3> positionNormals;
+        for (size_t i = 0; i < corners.size(); i += 3)
+        {
+            if (corners[i].Normal >= 0 && corners[i + 1].Normal >= 0 && corners[i + 2].Normal >= 0)
+                continue;
+            if (positionNormals.empty())
+                positionNormals.assign(positions.size(), glm::vec3(0.0f));
+            const glm::vec3& a = positions[corners[i].Position];
+            // the cross product's length is twice the area: larger faces weigh more
+            glm::vec3 faceNormal = glm::cross(positions[corners[i + 1].Position] - a, positions[corners[i + 2].Position] - a);
+            for (int k = 0; k < 3; k++)
+                positionNormals[corners[i + k].Position] += faceNormal;
+        }
+
+        mesh.Vertices.clear();
+        mesh.Indices.clear();
+        mesh.Indices.reserve(corners.size());
+        std::unordered_map<Corner, std::uint32_t, CornerHash> vertexIndices;
+        vertexIndices.reserve(corners.size() / 4);
+        for (const Corner& corner : corners)
+        {
+            auto inserted = vertexIndices.insert(std::make_pair(corner, (std::uint32_t)mesh.Vertices.size()));
+            if (inserted.second)
+            {
+                glm::vec3 normal = corner.Normal >= 0 ? normals[corner.Normal] : positionNormals[corner.Position];
+                float length = glm::length(normal);
+                normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+                glm::vec2 texCoord = corner.TexCoord >= 0 ? texCoords[corner.TexCoord] : glm::vec2(0.0f);
+                mesh.Vertices.push_back(packVertex(&positions[corner.Position].x, &normal.x, &texCoord.x));
+            }
+            mesh.Indices.push_back(inserted.first->second);
+        }
+        return true;
+    }
+
+private:
+    // zero-based indices, -1 when absent
+    struct Corner
+    {
+        std::int32_t Position;
+        std::int32_t TexCoord;
+        std::int32_t Normal;
+
+        bool operator==(const Corner& other) const
+        {
+            return Position == other.Position && TexCoord == other.TexCoord && Normal == other.Normal;
+        }
+    };
+
+    struct CornerHash
+    {
+        size_t operator()(const Corner& corner) const
+        {
+            std::uint64_t hash = (std::uint64_t)(std::uint32_t)corner.Position * 0x9E3779B97F4A7C15ull;
+            hash ^= ((std::uint64_t)(std::uint32_t)corner.TexCoord + 0x7F4A7C15ull) * 0xC2B2AE3D27D4EB4Full;
+            hash ^= ((std::uint64_t)(std::uint32_t)corner.Normal + 0x27D4EB4Full) * 0x165667B19E3779F9ull;
+            return (size_t)(hash ^ (hash >> 29));
+        }
+    };
+
+    static bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    static void skipSpaces(const char*& cursor, const char* end)
+    {
+        while (cursor < end && isSpace(*cursor))
+            cursor++;
+    }
+
+    static void skipLine(const char*& cursor, const char* end)
+    {
+        while (cursor < end && *cursor != '\n')
+            cursor++;
+        if (cursor < end)
+            cursor++;
+    }
+
+    // the mapping is not null-terminated, so strtod cannot be used on it
+    static float parseFloat(const char*& cursor, const char* end)
+    {
+        skipSpaces(cursor, end);
+        bool negative = false;
+        if (cursor < end && (*cursor == '-' || *cursor == '+'))
+            negative = *cursor++ == '-';
+        double value = 0.0;
+        while (cursor < end && *cursor >= '0' && *cursor <= '9')
+            value = value * 10.0 + (*cursor++ - '0');
+        if (cursor < end && *cursor == '.')
+        {
+            cursor++;
+            double scale = 0.1;
+            while (cursor < end && *cursor >= '0' && *cursor <= '9')
+            {
+                value += (*cursor++ - '0') * scale;
+                scale *= 0.1;
+            }
+        }
+        if (cursor < end && (*cursor == 'e' || *cursor == 'E'))
+        {
+            cursor++;
+            bool negativeExponent = false;
+            if (cursor < end && (*cursor == '-' || *cursor == '+'))
+                negativeExponent = *cursor++ == '-';
+            int exponent = 0;
+            while (cursor < end && *cursor >= '0' && *cursor <= '9')
+                exponent = exponent * 10 + (*cursor++ - '0');
+            value *= std::pow(10.0, negativeExponent ? -exponent : exponent);
+        }
+        return (float)(negative ? -value : value);
+    }
+
+    // a one-based (or negative, relative) OBJ index to a zero-based one; -1 when empty or out of range
+    static std::int32_t parseIndex(const char*& cursor, const char* end, size_t count)
+    {
+        bool negative = false;
+        if (cursor < end && *cursor == '-')
+        {
+            negative = true;
+            cursor++;
+        }
+        long long value = 0;
+        bool digits = false;
+        while (cursor < end && *cursor >= '0' && *cursor <= '9')
+        {
+            value = value * 10 + (*cursor++ - '0');
+            digits = true;
+        }
+        if (!digits)
+            return -1;
+        long long index = negative ? (long long)count - value : value - 1;
+        return index >= 0 && index < (long long)count ? (std::int32_t)index : -1;
+    }
+
+    // one "v", "v/vt", "v//vn" or "v/vt/vn" token (Position -1 when malformed); false at the end of the line
+    static bool parseCorner(const char*& cursor, const char* end, size_t positionCount, size_t texCoordCount, size_t normalCount, Corner& corner)
+    {
+        skipSpaces(cursor, end);
+        if (cursor >= end || *cursor == '\n')
+            return false;
+        corner.Position = parseIndex(cursor, end, positionCount);
+        corner.TexCoord = -1;
+        corner.Normal = -1;
+        if (cursor < end && *cursor == '/')
+        {
+            cursor++;
+            corner.TexCoord = parseIndex(cursor, end, texCoordCount);
+            if (cursor < end && *cursor == '/')
+            {
+                cursor++;
+                corner.Normal = parseIndex(cursor, end, normalCount);
+            }
+        }
+        // skip whatever is left of a malformed token
+        while (cursor < end && !isSpace(*cursor) && *cursor != '\n')
+            cursor++;
+        return true;
+    }
+};
+#endif
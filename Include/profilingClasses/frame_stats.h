@@ -0,0 +1,318 @@
+#pragma once
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cmath>
+
+// CPU phases of a frame, timed separately
+enum FramePhase {
+    PHASE_INPUT,
+    PHASE_UNIFORM_UPLOAD,
+    PHASE_CULLING,
+    PHASE_SORTING,
+    PHASE_DRAW_SUBMISSION,
+    PHASE_SWAP,
+    PHASE_COUNT
+};
+
+// GPU render passes, timed with timer queries; their results arrive a few frames late
+enum GpuPass {
+    GPU_PASS_DEPTH_PREPASS,
+    GPU_PASS_CUBES,
+    GPU_PASS_LAMP,
+    GPU_PASS_COUNT
+};
+
+// min/avg/percentiles/max of one timing channel, in milliseconds
+struct TimingSummary
+{
+    size_t Samples = 0;
+    double Min = 0.0;
+    double Average = 0.0;
+    double P50 = 0.0;
+    double P95 = 0.0;
+    double P99 = 0.0;
+    double Max = 0.0;
+};
+
+// Records the duration of every frame (and of each of its phases) into a fixed-size ring buffer,
+// so tail latency can be reported without the recorder growing or allocating while the app runs.
+// GPU pass times are attached later to the frame that issued them, as long as it is still in the buffer.
+class FrameStats
+{
+public:
+    explicit FrameStats(size_t capacity = 4096) : capacity(capacity > 0 ? capacity : 1), frames(this->capacity), nextFrame(0), recordedFrames(0), totalFrames(0)
+    {
+        sortedValues.reserve(this->capacity);
+    }
+
+    // marks the start of a frame; every phase timed until EndFrame belongs to it
+    void BeginFrame()
+    {
+        current = FrameRecord();
+        frameStart = Clock::now();
+    }
+
+    void BeginPhase(FramePhase phase)
+    {
+        phaseStarts[phase] = Clock::now();
+    }
+
+    void EndPhase(FramePhase phase)
+    {
+        current.PhaseMilliseconds[phase] += millisecondsSince(phaseStarts[phase]);
+    }
+
+    void EndFrame()
+    {
+        current.FrameMilliseconds = millisecondsSince(frameStart);
+        frames[nextFrame] = current;
+        nextFrame = (nextFrame + 1) % capacity;
+        if (recordedFrames < capacity)
+            recordedFrames++;
+        totalFrames++;
+    }
+
+    // serial number of the frame being recorded (the first frame is 0)
+    unsigned long long CurrentFrame() const
+    {
+        return totalFrames;
+    }
+
+    // attaches a GPU pass time to an already finished frame; dropped if that frame left the ring buffer
+    void RecordGpuTime(unsigned long long frame, GpuPass pass, double milliseconds)
+    {
+        if (frame >= totalFrames || totalFrames - frame > recordedFrames)
+            return;
+        size_t age = (size_t)(totalFrames - frame);
+        frames[(nextFrame + capacity - age) % capacity].GpuMilliseconds[pass] = milliseconds;
+    }
+
+    // number of frames currently held by the ring buffer
+    size_t FrameCount() const
+    {
+        return recordedFrames;
+    }
+
+    // summary of the frame times of the last frameCount frames (all held frames when 0)
+    TimingSummary SummarizeFrames(size_t frameCount = 0) const
+    {
+        return summarize(frameCount, [](const FrameRecord& frame) { return frame.FrameMilliseconds; });
+    }
+
+    TimingSummary SummarizePhase(FramePhase phase, size_t frameCount = 0) const
+    {
+        return summarize(frameCount, [phase](const FrameRecord& frame) { return frame.PhaseMilliseconds[phase]; });
+    }
+
+    // summary of the GPU time of a pass, over the frames whose timer query result already arrived
+    TimingSummary SummarizeGpuPass(GpuPass pass, size_t frameCount = 0) const
+    {
+        return summarize(frameCount, [pass](const FrameRecord& frame) { return frame.GpuMilliseconds[pass]; });
+    }
+
+    static const char* PhaseName(FramePhase phase)
+    {
+        static const char* names[PHASE_COUNT] = { "input", "uniform_upload", "culling", "sorting", "draw_submission", "swap" };
+        return names[phase];
+    }
+
+    static const char* GpuPassName(GpuPass pass)
+    {
+        static const char* names[GPU_PASS_COUNT] = { "gpu_depth_prepass", "gpu_cubes", "gpu_lamp" };
+        return names[pass];
+    }
+
+    // human readable report of the last frameCount frames (all held frames when 0)
+    void Print(std::ostream& out, size_t frameCount = 0) const
+    {
+        size_t count = clampCount(frameCount);
+        if (count == 0)
+            return;
+        TimingSummary frame = SummarizeFrames(count);
+        out << std::fixed << std::setprecision(3);
+        out << "Frame time over " << count << " frames (ms): ";
+        printSummary(out, frame);
+        out << "  (" << std::setprecision(1) << 1000.0 / frame.Average << " FPS)" << std::endl;
+        out << std::setprecision(3);
+        for (int phase = 0; phase < PHASE_COUNT; phase++)
+        {
+            out << "  " << std::left << std::setw(NAME_COLUMN_WIDTH) << PhaseName((FramePhase)phase) << std::right;
+            printSummary(out, SummarizePhase((FramePhase)phase, count));
+            out << std::endl;
+        }
+        for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+        {
+            out << "  " << std::left << std::setw(NAME_COLUMN_WIDTH) << GpuPassName((GpuPass)pass) << std::right;
+            TimingSummary gpu = SummarizeGpuPass((GpuPass)pass, count);
+            if (gpu.Samples == 0)
+                out << "no result";
+            else
+                printSummary(out, gpu);
+            out << std::endl;
+        }
+        out.unsetf(std::ios::floatfield);
+        out << std::setprecision(6);
+    }
+
+    // one line per frame, oldest first
+    bool WriteCsv(const std::string& path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::FRAME_STATS::CANNOT_WRITE: " << path << std::endl;
+            return false;
+        }
+        file << "frame,frame_ms";
+        for (int phase = 0; phase < PHASE_COUNT; phase++)
+            file << "," << PhaseName((FramePhase)phase) << "_ms";
+        for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+            file << "," << GpuPassName((GpuPass)pass) << "_ms";
+        file << "\n";
+        for (size_t i = 0; i < recordedFrames; i++)
+        {
+            const FrameRecord& frame = frameAt(i, recordedFrames);
+            file << i << "," << frame.FrameMilliseconds;
+            for (int phase = 0; phase < PHASE_COUNT; phase++)
+                file << "," << frame.PhaseMilliseconds[phase];
+            // empty field: the timer query result never arrived
+            for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+            {
+                file << ",";
+                if (frame.GpuMilliseconds[pass] >= 0.0)
+                    file << frame.GpuMilliseconds[pass];
+            }
+            file << "\n";
+        }
+        return true;
+    }
+
+    // summaries of every channel over all held frames
+    bool WriteJson(const std::string& path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::FRAME_STATS::CANNOT_WRITE: " << path << std::endl;
+            return false;
+        }
+        file << "{\n  \"frames\": " << recordedFrames << ",\n  \"frame_ms\": ";
+        writeJsonSummary(file, SummarizeFrames());
+        file << ",\n  \"phases_ms\": {";
+        for (int phase = 0; phase < PHASE_COUNT; phase++)
+        {
+            file << (phase == 0 ? "\n" : ",\n") << "    \"" << PhaseName((FramePhase)phase) << "\": ";
+            writeJsonSummary(file, SummarizePhase((FramePhase)phase));
+        }
+        file << "\n  },\n  \"gpu_passes_ms\": {";
+        for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+        {
+            file << (pass == 0 ? "\n" : ",\n") << "    \"" << GpuPassName((GpuPass)pass) << "\": ";
+            writeJsonSummary(file, SummarizeGpuPass((GpuPass)pass));
+        }
+        file << "\n  }\n}\n";
+        return true;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    // the longest phase or pass name ("gpu_depth_prepass") and two spaces before the values
+    enum { NAME_COLUMN_WIDTH = 19 };
+
+    struct FrameRecord
+    {
+        double FrameMilliseconds = 0.0;
+        double PhaseMilliseconds[PHASE_COUNT] = {};
+        // negative until the timer query result arrives, or when the pass did not run
+        double GpuMilliseconds[GPU_PASS_COUNT] = { -1.0, -1.0, -1.0 };
+    };
+
+    size_t capacity;
+    std::vector<FrameRecord> frames;
+    size_t nextFrame;
+    size_t recordedFrames;
+    unsigned long long totalFrames;
+
+    FrameRecord current;
+    Clock::time_point frameStart;
+    Clock::time_point phaseStarts[PHASE_COUNT];
+    // scratch buffer for the sorts, kept to avoid reallocating at every report
+    mutable std::vector<double> sortedValues;
+
+    static double millisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    size_t clampCount(size_t frameCount) const
+    {
+        return (frameCount == 0 || frameCount > recordedFrames) ? recordedFrames : frameCount;
+    }
+
+    // i-th of the last count frames, oldest first
+    const FrameRecord& frameAt(size_t i, size_t count) const
+    {
+        return frames[(nextFrame + capacity - count + i) % capacity];
+    }
+
+    template <typename Channel>
+    TimingSummary summarize(size_t frameCount, Channel channel) const
+    {
+        TimingSummary summary;
+        size_t count = clampCount(frameCount);
+        if (count == 0)
+            return summary;
+
+        // negative values are samples that are not available
+        sortedValues.clear();
+        double sum = 0.0;
+        for (size_t i = 0; i < count; i++)
+        {
+            double value = channel(frameAt(i, count));
+            if (value < 0.0)
+                continue;
+            sortedValues.push_back(value);
+            sum += value;
+        }
+        if (sortedValues.empty())
+            return summary;
+        count = sortedValues.size();
+        std::sort(sortedValues.begin(), sortedValues.end());
+
+        // nearest-rank percentiles
+        auto percentile = [&](double p) {
+            size_t rank = (size_t)std::ceil(p * count);
+            return sortedValues[rank > 0 ? rank - 1 : 0];
+        };
+        summary.Samples = count;
+        summary.Min = sortedValues.front();
+        summary.Average = sum / count;
+        summary.P50 = percentile(0.50);
+        summary.P95 = percentile(0.95);
+        summary.P99 = percentile(0.99);
+        summary.Max = sortedValues.back();
+        return summary;
+    }
+
+    static void printSummary(std::ostream& out, const TimingSummary& summary)
+    {
+        out << "min " << summary.Min << "  avg " << summary.Average << "  p50 " << summary.P50
+            << "  p95 " << summary.P95 << "  p99 " << summary.P99 << "  max " << summary.Max;
+    }
+
+    static void writeJsonSummary(std::ostream& out, const TimingSummary& summary)
+    {
+        out << "{ \"samples\": " << summary.Samples << ", \"min\": " << summary.Min << ", \"avg\": " << summary.Average << ", \"p50\": " << summary.P50
+            << ", \"p95\": " << summary.P95 << ", \"p99\": " << summary.P99 << ", \"max\": " << summary.Max << " }";
+    }
+};
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+#include <profilingClasses/frame_stats.h>
+
+// Times each GpuPass with GL_TIME_ELAPSED queries without ever stalling the pipeline.
+// Queries rotate through a pool deep enough for FramesInFlight frames; results are only read once
+// GL_QUERY_RESULT_AVAILABLE says so (usually 2-3 frames later) and are then attached to the frame that issued them.
+class GpuTimer
+{
+public:
+    static const int FramesInFlight = 4;
+
+    GpuTimer() : activePass(-1)
+    {
+        glGenQueries(FramesInFlight * GPU_PASS_COUNT, &queries[0][0]);
+        for (int slot = 0; slot < FramesInFlight; slot++)
+        {
+            for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+                pending[slot][pass] = false;
+            slotFrames[slot] = 0;
+        }
+        currentSlot = 0;
+    }
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    ~GpuTimer()
+    {
+        glDeleteQueries(FramesInFlight * GPU_PASS_COUNT, &queries[0][0]);
+    }
+
+    // collects every result that became available, then selects the query slot of the new frame
+    void BeginFrame(FrameStats& stats)
+    {
+        Collect(stats);
+        unsigned long long frame = stats.CurrentFrame();
+        currentSlot = (int)(frame % FramesInFlight);
+        // a result still pending after FramesInFlight frames is given up: the query object is reused
+        slotFrames[currentSlot] = frame;
+    }
+
+    void BeginPass(GpuPass pass)
+    {
+        glBeginQuery(GL_TIME_ELAPSED, queries[currentSlot][pass]);
+        activePass = pass;
+    }
+
+    void EndPass()
+    {
+        if (activePass < 0)
+            return;
+        glEndQuery(GL_TIME_ELAPSED);
+        pending[currentSlot][activePass] = true;
+        activePass = -1;
+    }
+
+    // reads back the available results, oldest frame first; never waits for the GPU
+    void Collect(FrameStats& stats)
+    {
+        for (int age = FramesInFlight - 1; age >= 0; age--)
+        {
+            int slot = (currentSlot + FramesInFlight - age) % FramesInFlight;
+            for (int pass = 0; pass < GPU_PASS_COUNT; pass++)
+            {
+                if (!pending[slot][pass])
+                    continue;
+                GLint available = GL_FALSE;
+                glGetQueryObjectiv(queries[slot][pass], GL_QUERY_RESULT_AVAILABLE, &available);
+                if (!available)
+                    continue;
+                GLuint64 nanoseconds = 0;
+                glGetQueryObjectui64v(queries[slot][pass], GL_QUERY_RESULT, &nanoseconds);
+                pending[slot][pass] = false;
+                stats.RecordGpuTime(slotFrames[slot], (GpuPass)pass, (double)nanoseconds / 1.0e6);
+            }
+        }
+    }
+
+private:
+    unsigned int queries[FramesInFlight][GPU_PASS_COUNT];
+    bool pending[FramesInFlight][GPU_PASS_COUNT];
+    unsigned long long slotFrames[FramesInFlight];
+    int currentSlot;
+    int activePass;
+};
+#endif
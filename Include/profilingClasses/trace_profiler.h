@@ -0,0 +1,248 @@
+#pragma once
+#ifndef TRACE_PROFILER_H
+#define TRACE_PROFILER_H
+
+// Scoped-zone profiler writing the Chrome trace event format, loadable in chrome://tracing and Perfetto.
+//
+//   TRACE_ZONE("cube pass");   // times the enclosing scope
+//
+// Build with ENABLE_TRACE_PROFILER=0 to compile every zone out. When compiled in, zones cost a single
+// branch until TraceProfiler::Start() is called; once capturing, a zone reads the timestamp counter twice and
+// appends one event to a buffer owned by the calling thread, without locking. That buffer is allocated on the
+// thread's first event, so a run without a capture allocates none.
+
+#ifndef ENABLE_TRACE_PROFILER
+#define ENABLE_TRACE_PROFILER 1
+#endif
+
+#if ENABLE_TRACE_PROFILER
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define TRACE_PROFILER_HAS_TSC 1
+#elif (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <x86intrin.h>
+#define TRACE_PROFILER_HAS_TSC 1
+#endif
+
+class TraceProfiler
+{
+public:
+    // events a thread can record during one capture; later events are dropped and counted
+    static const size_t EventsPerThread = 1 << 18;
+
+    // starts capturing; Write only keeps the events recorded after the last Start
+    static void Start()
+    {
+        TraceProfiler& profiler = instance();
+        profiler.startTicks = Timestamp();
+        profiler.startTime = std::chrono::steady_clock::now();
+        capturing().store(true, std::memory_order_release);
+    }
+
+    static void Stop()
+    {
+        capturing().store(false, std::memory_order_release);
+    }
+
+    static bool IsCapturing()
+    {
+        return capturing().load(std::memory_order_relaxed);
+    }
+
+    // raw timestamp, in TSC ticks where available
+    static std::uint64_t Timestamp()
+    {
+#ifdef TRACE_PROFILER_HAS_TSC
+        return __rdtsc();
+#else
+        return (std::uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    static void Record(const char* name, std::uint64_t startTicks, std::uint64_t endTicks)
+    {
+        ThreadBuffer* buffer = threadBuffer();
+        size_t count = buffer->Count.load(std::memory_order_relaxed);
+        if (count >= EventsPerThread)
+        {
+            buffer->Dropped++;
+            return;
+        }
+        buffer->Events[count] = { name, startTicks, endTicks };
+        // publish the event to the thread that will write the trace
+        buffer->Count.store(count + 1, std::memory_order_release);
+    }
+
+    // names the calling thread in the trace. Only remembered until the thread records its first event: a thread
+    // that never does so, as when no capture is started, gets no buffer
+    static void SetThreadName(const char* name)
+    {
+        threadName() = name;
+        if (ThreadBuffer* buffer = threadBufferSlot())
+            buffer->Name = name;
+    }
+
+    // stops the capture and writes every recorded event as a Chrome trace JSON file
+    static bool Write(const std::string& path)
+    {
+        Stop();
+        TraceProfiler& profiler = instance();
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::TRACE_PROFILER::CANNOT_WRITE: " << path << std::endl;
+            return false;
+        }
+
+        // ticks to microseconds, calibrated over the whole capture
+        double elapsedMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - profiler.startTime).count();
+        double elapsedTicks = (double)(Timestamp() - profiler.startTicks);
+        double microsecondsPerTick = elapsedTicks > 0.0 ? elapsedMicroseconds / elapsedTicks : 0.0;
+
+        std::lock_guard<std::mutex> lock(profiler.buffersMutex);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        size_t dropped = 0;
+        for (const std::unique_ptr<ThreadBuffer>& buffer : profiler.buffers)
+        {
+            file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->ThreadId
+                << ",\"args\":{\"name\":\"" << buffer->Name << "\"}}";
+            first = false;
+
+            size_t count = buffer->Count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < count; i++)
+            {
+                const Event& event = buffer->Events[i];
+                // events recorded before Start belong to no capture
+                if (event.StartTicks < profiler.startTicks)
+                    continue;
+                double start = (double)(event.StartTicks - profiler.startTicks) * microsecondsPerTick;
+                double duration = (double)(event.EndTicks - event.StartTicks) * microsecondsPerTick;
+                file << ",\n{\"name\":\"" << event.Name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->ThreadId
+                    << ",\"ts\":" << start << ",\"dur\":" << duration << "}";
+            }
+            dropped += buffer->Dropped;
+        }
+        file << "\n]}\n";
+
+        if (dropped > 0)
+            std::cout << "WARNING::TRACE_PROFILER::EVENTS_DROPPED: " << dropped << std::endl;
+        return true;
+    }
+
+private:
+    struct Event
+    {
+        const char* Name;
+        std::uint64_t StartTicks;
+        std::uint64_t EndTicks;
+    };
+
+    // written only by its own thread; Count is the publication point for the writer
+    struct ThreadBuffer
+    {
+        std::unique_ptr<Event[]> Events;
+        std::atomic<size_t> Count;
+        size_t Dropped;
+        unsigned int ThreadId;
+        const char* Name;
+    };
+
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::uint64_t startTicks = 0;
+    std::chrono::steady_clock::time_point startTime;
+
+    static TraceProfiler& instance()
+    {
+        static TraceProfiler profiler;
+        return profiler;
+    }
+
+    static std::atomic<bool>& capturing()
+    {
+        static std::atomic<bool> flag(false);
+        return flag;
+    }
+
+    static const char*& threadName()
+    {
+        static thread_local const char* name = "thread";
+        return name;
+    }
+
+    // NULL until the calling thread records an event
+    static ThreadBuffer*& threadBufferSlot()
+    {
+        static thread_local ThreadBuffer* buffer = NULL;
+        return buffer;
+    }
+
+    // the calling thread's buffer, allocated and registered on its first event
+    static ThreadBuffer* threadBuffer()
+    {
+        ThreadBuffer*& buffer = threadBufferSlot();
+        if (buffer == NULL)
+        {
+            TraceProfiler& profiler = instance();
+            std::unique_ptr<ThreadBuffer> newBuffer(new ThreadBuffer());
+            // value-initialized so the pages are touched here rather than inside the first zones
+            newBuffer->Events.reset(new Event[EventsPerThread]());
+            newBuffer->Count.store(0, std::memory_order_relaxed);
+            newBuffer->Dropped = 0;
+            newBuffer->Name = threadName();
+
+            std::lock_guard<std::mutex> lock(profiler.buffersMutex);
+            newBuffer->ThreadId = (unsigned int)profiler.buffers.size() + 1;
+            buffer = newBuffer.get();
+            profiler.buffers.push_back(std::move(newBuffer));
+        }
+        return buffer;
+    }
+};
+
+// RAII zone: records the lifetime of the enclosing scope when a capture is running
+class TraceZone
+{
+public:
+    explicit TraceZone(const char* name) : name(name), startTicks(TraceProfiler::IsCapturing() ? TraceProfiler::Timestamp() : 0)
+    {
+    }
+
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+    ~TraceZone()
+    {
+        if (startTicks != 0)
+            TraceProfiler::Record(name, startTicks, TraceProfiler::Timestamp());
+    }
+
+private:
+    const char* name;
+    std::uint64_t startTicks;
+};
+
+#define TRACE_CONCATENATE_IMPL(a, b) a##b
+#define TRACE_CONCATENATE(a, b) TRACE_CONCATENATE_IMPL(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCATENATE(traceZone, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) TraceProfiler::SetThreadName(name)
+
+#else
+
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+
+#endif
+#endif
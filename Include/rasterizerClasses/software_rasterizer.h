@@ -0,0 +1,638 @@
+#pragma once
+#ifndef SOFTWARE_RASTERIZER_H
+#define SOFTWARE_RASTERIZER_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <sceneClasses/cube_field.h>
+#include <sceneClasses/cube_mesh.h>
+#include <sceneClasses/frustum_culler.h>
+#include <sceneClasses/negative_light.h>
+#include <sceneClasses/transform_stage.h>
+#include <simdClasses/float_lanes.h>
+#include <threadingClasses/worker_pool.h>
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// CPU reference renderer of the scene drawn by main(): the cube field, the orbiting light and its lamp cube.
+// Triangles are binned into square tiles, and tiles are rasterized in parallel on a WorkerPool; each tile
+// processes its triangles in submission order, so the image does not depend on the thread count.
+// Pixels are shaded FloatLanes::Count at a time (8 with AVX2) with the lighting equation of
+// mainCubeFragmentShader.glsl: ambient minus attenuated diffuse and specular.
+// Textures are sampled bilinearly from their base level (no mipmapping), so distant cubes differ slightly from the GPU image.
+// Like a GPU, coverage is exact: vertices are snapped to a grid of 1/256 pixel and the edge functions are evaluated in
+// 64-bit integers, so the two triangles of a shared edge get exactly opposite values and the top-left rule gives every
+// pixel center on that edge to one of them, never neither. Triangles are clipped to a guard band around the viewport
+// first, which bounds the snapped coordinates so those products cannot overflow.
+class SoftwareRasterizer
+{
+public:
+    static const int TileSize = 64;
+    static const int SubpixelBits = 8;
+    // clip-space guard band: |x| and |y| at most GuardBand * w
+    static const int GuardBand = 4;
+
+    SoftwareRasterizer(int width, int height, WorkerPool& pool) : width(width), height(height), pool(pool)
+    {
+        // rows are padded to a whole number of lane packs so spans never read past a row
+        rowStride = (width + FloatLanes::Count - 1) / FloatLanes::Count * FloatLanes::Count;
+        depthBuffer.resize((size_t)rowStride * height);
+        pixels.resize((size_t)width * height * 3);
+        tilesX = (width + TileSize - 1) / TileSize;
+        tilesY = (height + TileSize - 1) / TileSize;
+        tileBins.resize((size_t)tilesX * tilesY);
+    }
+
+    bool LoadTextures(const char* diffusePath, const char* specularPath)
+    {
+        return diffuseMap.Load(diffusePath) && specularMap.Load(specularPath);
+    }
+
+    void SetObjects(const CubeField& cubeField)
+    {
+        transformStage.SetObjects(cubeField.Instances);
+        frustumCuller.SetObjects(cubeField.Instances, CUBE_BOUNDING_RADIUS);
+    }
+
+    void RenderFrame(const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix, const glm::vec3& lightPosition, const NegativeLightProperties& light)
+    {
+        this->light = light;
+        lightViewPosition = glm::vec3(viewMatrix * glm::vec4(lightPosition, 1.0f));
+
+        // vertex stage: transform every cube in the frustum in parallel, one triangle list per chunk of cubes
+        if (FrustumCuller::Enabled())
+        {
+            frustumCuller.Cull(projectionMatrix * viewMatrix, &pool);
+            transformStage.Update(viewMatrix, frustumCuller.Visible);
+        }
+        else
+            transformStage.Update(viewMatrix);
+        const size_t cubesPerChunk = 256;
+        const size_t cubeCount = transformStage.Count();
+        const size_t chunkCount = (cubeCount + cubesPerChunk - 1) / cubesPerChunk + 1; // + 1: the lamp
+        chunkTriangles.resize(chunkCount);
+        pool.ParallelFor(chunkCount, [&](size_t chunk) {
+            std::vector<TriangleSetup>& triangles = chunkTriangles[chunk];
+            triangles.clear();
+            if (chunk == chunkCount - 1)
+            {
+                glm::mat4 lampModel = glm::scale(glm::translate(glm::mat4(1.0f), lightPosition), glm::vec3(0.2f));
+                glm::mat4 lampModelView = viewMatrix * lampModel;
+                processCube(projectionMatrix, lampModelView, glm::mat3(lampModelView), true, triangles);
+                return;
+            }
+            size_t end = std::min(cubeCount, (chunk + 1) * cubesPerChunk);
+            for (size_t i = chunk * cubesPerChunk; i < end; i++)
+            {
+                const ViewSpaceTransform& transform = transformStage.Output[i];
+                glm::mat4 modelView;
+                glm::mat3 normalMatrix;
+                for (int column = 0; column < 4; column++)
+                    modelView[column] = glm::vec4(transform.ModelViewMatrix[column * 4], transform.ModelViewMatrix[column * 4 + 1],
+                        transform.ModelViewMatrix[column * 4 + 2], transform.ModelViewMatrix[column * 4 + 3]);
+                for (int column = 0; column < 3; column++)
+                    normalMatrix[column] = glm::vec3(transform.NormalMatrix[column * 4], transform.NormalMatrix[column * 4 + 1], transform.NormalMatrix[column * 4 + 2]);
+                processCube(projectionMatrix, modelView, normalMatrix, false, triangles);
+            }
+        });
+
+        // binning, in submission order (cubes first, then the lamp as in main())
+        triangles.clear();
+        for (std::vector<TriangleSetup>& chunk : chunkTriangles)
+            triangles.insert(triangles.end(), chunk.begin(), chunk.end());
+        for (std::vector<unsigned int>& bin : tileBins)
+            bin.clear();
+        for (unsigned int t = 0; t < (unsigned int)triangles.size(); t++)
+        {
+            const TriangleSetup& triangle = triangles[t];
+            for (int tileY = triangle.MinY / TileSize; tileY <= triangle.MaxY / TileSize; tileY++)
+                for (int tileX = triangle.MinX / TileSize; tileX <= triangle.MaxX / TileSize; tileX++)
+                    tileBins[(size_t)tileY * tilesX + tileX].push_back(t);
+        }
+
+        // pixel stage
+        pool.ParallelFor(tileBins.size(), [&](size_t tile) { rasterizeTile((int)tile); });
+    }
+
+    // 8-bit RGB, rows from top to bottom
+    const std::vector<unsigned char>& Pixels() const
+    {
+        return pixels;
+    }
+
+    int Width() const { return width; }
+    int Height() const { return height; }
+
+    unsigned int TriangleCount() const
+    {
+        return (unsigned int)triangles.size();
+    }
+
+private:
+    // RGBA8 texture sampled with GL_REPEAT and GL_LINEAR on its base level
+    struct Texture
+    {
+        int Width = 0;
+        int Height = 0;
+        std::vector<std::uint32_t> Texels;
+
+        bool Load(const char* path)
+        {
+            int components = 0;
+            unsigned char* data = stbi_load(path, &Width, &Height, &components, 4);
+            if (!data)
+            {
+                std::cout << "Texture failed to load at path: " << path << std::endl;
+                return false;
+            }
+            Texels.resize((size_t)Width * Height);
+            for (size_t i = 0; i < Texels.size(); i++)
+                Texels[i] = data[i * 4] | (data[i * 4 + 1] << 8) | (data[i * 4 + 2] << 16) | ((std::uint32_t)data[i * 4 + 3] << 24);
+            stbi_image_free(data);
+            return true;
+        }
+    };
+
+    // a vertex after the vertex stage: clip-space position and the varyings of mainCubeVertexShader.glsl
+    struct ClipVertex
+    {
+        glm::vec4 Clip;
+        float Varyings[8]; // view-space position, view-space normal, texture coordinates
+    };
+
+    // screen-space plane equation: value = A * x + B * y + C
+    struct Plane
+    {
+        float A, B, C;
+    };
+
+    // edge function on the subpixel grid: value = A * x + B * y + C, x and y in 1/256 pixel; a pixel is inside
+    // when the value is at least 0 for the three edges (C is 1 lower on the edges that exclude their pixel centers)
+    struct EdgeFunction
+    {
+        std::int64_t A, B, C;
+    };
+
+    struct TriangleSetup
+    {
+        EdgeFunction Edges[3];
+        Plane Depth;
+        Plane InverseW;
+        Plane Varyings[8]; // varying / w, interpolated linearly in screen space
+        int MinX, MinY, MaxX, MaxY;
+        bool Lamp;
+    };
+
+    int width, height, rowStride;
+    int tilesX, tilesY;
+    WorkerPool& pool;
+
+    Texture diffuseMap;
+    Texture specularMap;
+    TransformStage transformStage;
+    FrustumCuller frustumCuller;
+    NegativeLightProperties light;
+    glm::vec3 lightViewPosition;
+
+    std::vector<std::vector<TriangleSetup>> chunkTriangles;
+    std::vector<TriangleSetup> triangles;
+    std::vector<std::vector<unsigned int>> tileBins;
+    std::vector<float> depthBuffer;
+    std::vector<unsigned char> pixels;
+
+    void processCube(const glm::mat4& projectionMatrix, const glm::mat4& modelView, const glm::mat3& normalMatrix, bool lamp, std::vector<TriangleSetup>& output) const
+    {
+        ClipVertex vertices[CUBE_VERTEX_COUNT];
+        for (unsigned int v = 0; v < CUBE_VERTEX_COUNT; v++)
+        {
+            const float* source = CUBE_VERTICES + v * CUBE_VERTEX_STRIDE;
+            glm::vec4 viewPosition = modelView * glm::vec4(source[0], source[1], source[2], 1.0f);
+            glm::vec3 normal = glm::normalize(normalMatrix * glm::vec3(source[3], source[4], source[5]));
+            ClipVertex& vertex = vertices[v];
+            vertex.Clip = projectionMatrix * viewPosition;
+            vertex.Varyings[0] = viewPosition.x;
+            vertex.Varyings[1] = viewPosition.y;
+            vertex.Varyings[2] = viewPosition.z;
+            vertex.Varyings[3] = normal.x;
+            vertex.Varyings[4] = normal.y;
+            vertex.Varyings[5] = normal.z;
+            vertex.Varyings[6] = source[6];
+            vertex.Varyings[7] = source[7];
+        }
+        for (unsigned int v = 0; v < CUBE_VERTEX_COUNT; v += 3)
+            clipTriangle(vertices[v], vertices[v + 1], vertices[v + 2], lamp, output);
+    }
+
+    static ClipVertex lerpVertex(const ClipVertex& a, const ClipVertex& b, float t)
+    {
+        ClipVertex result;
+        result.Clip = a.Clip + (b.Clip - a.Clip) * t;
+        for (int i = 0; i < 8; i++)
+            result.Varyings[i] = a.Varyings[i] + (b.Varyings[i] - a.Varyings[i]) * t;
+        return result;
+    }
+
+    // signed distance of a vertex to a clip plane: near (z >= -w), then the four guard band planes
+    static float clipDistance(const glm::vec4& p, int plane)
+    {
+        const float guardBand = (float)GuardBand;
+        switch (plane)
+        {
+        case 0: return p.z + p.w;
+        case 1: return guardBand * p.w - p.x;
+        case 2: return guardBand * p.w + p.x;
+        case 3: return guardBand * p.w - p.y;
+        default: return guardBand * p.w + p.y;
+        }
+    }
+
+    // rejects triangles outside the frustum and clips the others against the near plane and the guard band;
+    // the other planes are handled by the screen-space bounding box and the per-pixel depth test
+    void clipTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, bool lamp, std::vector<TriangleSetup>& output) const
+    {
+        const ClipVertex* input[3] = { &a, &b, &c };
+        int outsideMask = 0x3f;
+        for (int i = 0; i < 3; i++)
+        {
+            const glm::vec4& p = input[i]->Clip;
+            int outside = (p.x > p.w ? 1 : 0) | (p.x < -p.w ? 2 : 0) | (p.y > p.w ? 4 : 0) | (p.y < -p.w ? 8 : 0)
+                | (p.z > p.w ? 16 : 0) | (p.z < -p.w ? 32 : 0);
+            outsideMask &= outside;
+        }
+        if (outsideMask != 0)
+            return;
+
+        // each plane adds at most one vertex
+        ClipVertex polygons[2][8];
+        int polygonSize = 3;
+        for (int i = 0; i < 3; i++)
+            polygons[0][i] = *input[i];
+        int current = 0;
+        for (int plane = 0; plane < 5 && polygonSize >= 3; plane++)
+        {
+            const ClipVertex* polygon = polygons[current];
+            float distances[8];
+            bool anyOutside = false;
+            for (int i = 0; i < polygonSize; i++)
+            {
+                distances[i] = clipDistance(polygon[i].Clip, plane);
+                anyOutside = anyOutside || distances[i] < 0.0f;
+            }
+            if (!anyOutside)
+                continue;
+            ClipVertex* clipped = polygons[1 - current];
+            int clippedSize = 0;
+            for (int i = 0; i < polygonSize; i++)
+            {
+                int next = (i + 1) % polygonSize;
+                if (distances[i] >= 0.0f)
+                    clipped[clippedSize++] = polygon[i];
+                // always interpolated from the inside vertex: the triangle on the other side of this edge, which
+                // walks it the other way, gets the very same vertex
+                if (distances[i] >= 0.0f && distances[next] < 0.0f)
+                    clipped[clippedSize++] = lerpVertex(polygon[i], polygon[next], distances[i] / (distances[i] - distances[next]));
+                else if (distances[i] < 0.0f && distances[next] >= 0.0f)
+                    clipped[clippedSize++] = lerpVertex(polygon[next], polygon[i], distances[next] / (distances[next] - distances[i]));
+            }
+            polygonSize = clippedSize;
+            current = 1 - current;
+        }
+        for (int i = 1; i + 1 < polygonSize; i++)
+            setupTriangle(polygons[current][0], polygons[current][i], polygons[current][i + 1], lamp, output);
+    }
+
+    void setupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, bool lamp, std::vector<TriangleSetup>& output) const
+    {
+        const ClipVertex* vertices[3] = { &a, &b, &c };
+        const float subpixels = (float)(1 << SubpixelBits);
+        std::int64_t x[3], y[3];
+        float z[3], inverseW[3];
+        for (int i = 0; i < 3; i++)
+        {
+            const glm::vec4& clip = vertices[i]->Clip;
+            inverseW[i] = 1.0f / clip.w;
+            // viewport transform, snapped to the subpixel grid; screen rows go from top to bottom
+            x[i] = (std::int64_t)std::floor((clip.x * inverseW[i] * 0.5f + 0.5f) * width * subpixels + 0.5f);
+            y[i] = (std::int64_t)std::floor((0.5f - clip.y * inverseW[i] * 0.5f) * height * subpixels + 0.5f);
+            z[i] = clip.z * inverseW[i] * 0.5f + 0.5f;
+        }
+
+        TriangleSetup setup;
+        // edge i is opposite vertex i
+        for (int i = 0; i < 3; i++)
+        {
+            int j = (i + 1) % 3, k = (i + 2) % 3;
+            setup.Edges[i].A = y[j] - y[k];
+            setup.Edges[i].B = x[k] - x[j];
+            setup.Edges[i].C = x[j] * y[k] - y[j] * x[k];
+        }
+        std::int64_t area = setup.Edges[0].A * x[0] + setup.Edges[0].B * y[0] + setup.Edges[0].C;
+        if (area == 0)
+            return;
+        // no face culling in main(): both windings are drawn, edges are oriented so the inside is positive
+        if (area < 0)
+        {
+            area = -area;
+            for (int i = 0; i < 3; i++)
+            {
+                setup.Edges[i].A = -setup.Edges[i].A;
+                setup.Edges[i].B = -setup.Edges[i].B;
+                setup.Edges[i].C = -setup.Edges[i].C;
+            }
+        }
+
+        // attributes are interpolated in pixel units with the barycentric weights edge / area, before the fill
+        // convention bias
+        const double inverseArea = 1.0 / (double)area;
+        auto makePlane = [&](const float values[3]) {
+            double planeA = 0.0, planeB = 0.0, planeC = 0.0;
+            for (int i = 0; i < 3; i++)
+            {
+                double weight = values[i] * inverseArea;
+                planeA += (double)setup.Edges[i].A * subpixels * weight;
+                planeB += (double)setup.Edges[i].B * subpixels * weight;
+                planeC += (double)setup.Edges[i].C * weight;
+            }
+            Plane plane = { (float)planeA, (float)planeB, (float)planeC };
+            return plane;
+        };
+        setup.Depth = makePlane(z);
+        setup.InverseW = makePlane(inverseW);
+        for (int v = 0; v < 8; v++)
+        {
+            float values[3];
+            for (int i = 0; i < 3; i++)
+                values[i] = vertices[i]->Varyings[v] * inverseW[i];
+            setup.Varyings[v] = makePlane(values);
+        }
+
+        // fill convention (top-left rule): a pixel center exactly on an edge belongs to the triangle for which that
+        // edge is a left edge or a top edge, so the integer test "value > 0" becomes "value - 1 >= 0" on the others
+        for (int i = 0; i < 3; i++)
+        {
+            bool inclusive = setup.Edges[i].A > 0 || (setup.Edges[i].A == 0 && setup.Edges[i].B > 0);
+            if (!inclusive)
+                setup.Edges[i].C -= 1;
+        }
+
+        const float pixelsPerSubpixel = 1.0f / subpixels;
+        std::int64_t minX = std::min(x[0], std::min(x[1], x[2])), maxX = std::max(x[0], std::max(x[1], x[2]));
+        std::int64_t minY = std::min(y[0], std::min(y[1], y[2])), maxY = std::max(y[0], std::max(y[1], y[2]));
+        setup.MinX = std::max(0, (int)std::floor(minX * pixelsPerSubpixel));
+        setup.MinY = std::max(0, (int)std::floor(minY * pixelsPerSubpixel));
+        setup.MaxX = std::min(width - 1, (int)std::ceil(maxX * pixelsPerSubpixel));
+        setup.MaxY = std::min(height - 1, (int)std::ceil(maxY * pixelsPerSubpixel));
+        if (setup.MinX > setup.MaxX || setup.MinY > setup.MaxY)
+            return;
+        setup.Lamp = lamp;
+        output.push_back(setup);
+    }
+
+    static FloatLanes evaluate(const Plane& plane, FloatLanes x, FloatLanes y)
+    {
+        return FloatLanes::Set1(plane.A) * x + FloatLanes::Set1(plane.B) * y + FloatLanes::Set1(plane.C);
+    }
+
+    // all bits set in the lanes whose bit is set in `bits`
+    static FloatLanes laneMask(int bits)
+    {
+        float lanes[FloatLanes::Count];
+        for (int lane = 0; lane < FloatLanes::Count; lane++)
+            lanes[lane] = (bits & (1 << lane)) ? 1.0f : 0.0f;
+        return FloatLanes::Greater(FloatLanes::Load(lanes), FloatLanes::Set1(0.0f));
+    }
+
+    void rasterizeTile(int tile)
+    {
+        const int tileX0 = (tile % tilesX) * TileSize, tileY0 = (tile / tilesX) * TileSize;
+        const int tileX1 = std::min(tileX0 + TileSize, width) - 1, tileY1 = std::min(tileY0 + TileSize, height) - 1;
+
+        // clear
+        for (int y = tileY0; y <= tileY1; y++)
+        {
+            std::fill(depthBuffer.begin() + (size_t)y * rowStride + tileX0, depthBuffer.begin() + (size_t)y * rowStride + tileX1 + 1, 1.0f);
+            unsigned char* row = &pixels[((size_t)y * width + tileX0) * 3];
+            const unsigned char clearValue = toByte(0.1f);
+            std::fill(row, row + (tileX1 - tileX0 + 1) * 3, clearValue);
+        }
+
+        const FloatLanes laneOffsets = FloatLanes::Ramp() + FloatLanes::Set1(0.5f);
+        const FloatLanes one = FloatLanes::Set1(1.0f);
+        const std::int64_t pixelStep = (std::int64_t)1 << SubpixelBits, halfPixel = pixelStep / 2;
+        const int allLanes = (1 << FloatLanes::Count) - 1;
+
+        for (unsigned int triangleIndex : tileBins[tile])
+        {
+            const TriangleSetup& triangle = triangles[triangleIndex];
+            int x0 = std::max(tileX0, triangle.MinX), x1 = std::min(tileX1, triangle.MaxX);
+            int y0 = std::max(tileY0, triangle.MinY), y1 = std::min(tileY1, triangle.MaxY);
+            // spans start on lane-pack boundaries so the depth loads stay inside the padded row
+            x0 -= (x0 - tileX0) % FloatLanes::Count;
+
+            for (int y = y0; y <= y1; y++)
+            {
+                const FloatLanes pixelY = FloatLanes::Set1((float)y + 0.5f);
+                float* depthRow = &depthBuffer[(size_t)y * rowStride];
+                // exact edge values at the first pixel center of the row, then stepped one pixel at a time
+                std::int64_t rowEdges[3];
+                for (int e = 0; e < 3; e++)
+                {
+                    const EdgeFunction& edge = triangle.Edges[e];
+                    rowEdges[e] = edge.A * (x0 * pixelStep + halfPixel) + edge.B * (y * pixelStep + halfPixel) + edge.C;
+                }
+                for (int x = x0; x <= x1; x += FloatLanes::Count)
+                {
+                    // the values are linear across the pack: the first and last lanes bound them, and only an edge
+                    // crossing the pack needs its lanes tested one by one
+                    int coverageBits = x + FloatLanes::Count <= width ? allLanes : (1 << (width - x)) - 1;
+                    for (int e = 0; e < 3 && coverageBits != 0; e++)
+                    {
+                        const std::int64_t step = triangle.Edges[e].A * pixelStep;
+                        const std::int64_t first = rowEdges[e], last = first + step * (FloatLanes::Count - 1);
+                        if (first < 0 && last < 0)
+                            coverageBits = 0;
+                        else if (first < 0 || last < 0)
+                        {
+                            int edgeBits = 0;
+                            for (int lane = 0; lane < FloatLanes::Count; lane++)
+                            {
+                                if (first + step * lane >= 0)
+                                    edgeBits |= 1 << lane;
+                            }
+                            coverageBits &= edgeBits;
+                        }
+                    }
+                    for (int e = 0; e < 3; e++)
+                        rowEdges[e] += triangle.Edges[e].A * pixelStep * FloatLanes::Count;
+                    if (coverageBits == 0)
+                        continue;
+
+                    const FloatLanes pixelX = FloatLanes::Set1((float)x) + laneOffsets;
+                    FloatLanes coverage = laneMask(coverageBits);
+
+                    // GL_LESS depth test, and depth clipping against the far plane
+                    FloatLanes depth = evaluate(triangle.Depth, pixelX, pixelY);
+                    FloatLanes storedDepth = FloatLanes::Load(depthRow + x);
+                    coverage = FloatLanes::And(coverage, FloatLanes::And(FloatLanes::Less(depth, storedDepth), FloatLanes::LessEqual(depth, one)));
+                    coverageBits = FloatLanes::MoveMask(coverage);
+                    if (coverageBits == 0)
+                        continue;
+                    FloatLanes::Select(coverage, depth, storedDepth).Store(depthRow + x);
+
+                    Vec3Lanes color;
+                    if (triangle.Lamp)
+                        color = Vec3Lanes::Set1(0.0f, 0.0f, 0.0f);
+                    else
+                        color = shade(triangle, pixelX, pixelY, coverage);
+
+                    float red[FloatLanes::Count], green[FloatLanes::Count], blue[FloatLanes::Count];
+                    FloatLanes::Clamp(color.x, 0.0f, 1.0f).Store(red);
+                    FloatLanes::Clamp(color.y, 0.0f, 1.0f).Store(green);
+                    FloatLanes::Clamp(color.z, 0.0f, 1.0f).Store(blue);
+                    for (int lane = 0; lane < FloatLanes::Count; lane++)
+                    {
+                        if (!(coverageBits & (1 << lane)))
+                            continue;
+                        unsigned char* pixel = &pixels[((size_t)y * width + x + lane) * 3];
+                        pixel[0] = toByte(red[lane]);
+                        pixel[1] = toByte(green[lane]);
+                        pixel[2] = toByte(blue[lane]);
+                    }
+                }
+            }
+        }
+    }
+
+    // mainCubeFragmentShader.glsl, FloatLanes::Count fragments at a time. Lanes outside `coverage` lie off the
+    // triangle, where 1/w may reach 0: their texture coordinates are replaced by 0 and their colors are not used
+    Vec3Lanes shade(const TriangleSetup& triangle, FloatLanes pixelX, FloatLanes pixelY, FloatLanes coverage) const
+    {
+        // perspective-correct varyings
+        FloatLanes w = FloatLanes::Set1(1.0f) / evaluate(triangle.InverseW, pixelX, pixelY);
+        FloatLanes varyings[8];
+        for (int v = 0; v < 8; v++)
+            varyings[v] = evaluate(triangle.Varyings[v], pixelX, pixelY) * w;
+        Vec3Lanes fragmentPosition = { varyings[0], varyings[1], varyings[2] };
+        // like the shader, the interpolated normal is not renormalized
+        Vec3Lanes normal = { varyings[3], varyings[4], varyings[5] };
+        const FloatLanes zero = FloatLanes::Set1(0.0f);
+        FloatLanes u = FloatLanes::Select(coverage, varyings[6], zero), v = FloatLanes::Select(coverage, varyings[7], zero);
+
+        Vec3Lanes diffuseTexel = sample(diffuseMap, u, v);
+        Vec3Lanes specularTexel = sample(specularMap, u, v);
+
+        // Ambient Lighting
+        Vec3Lanes ambientColor = Vec3Lanes::Set1(light.Ambient.x, light.Ambient.y, light.Ambient.z) * diffuseTexel;
+
+        // Diffuse Lighting
+        Vec3Lanes toLight = Vec3Lanes::Set1(lightViewPosition.x, lightViewPosition.y, lightViewPosition.z) - fragmentPosition;
+        Vec3Lanes lightDirection = Vec3Lanes::Normalize(toLight);
+        FloatLanes normalDotLight = Vec3Lanes::Dot(normal, lightDirection);
+        FloatLanes diffuseQuantity = FloatLanes::Max(normalDotLight, FloatLanes::Set1(0.0f));
+        Vec3Lanes diffuseColor = Vec3Lanes::Set1(light.Diffuse.x, light.Diffuse.y, light.Diffuse.z) * diffuseQuantity * diffuseTexel;
+
+        // Specular Lighting: reflect(-L, N) = 2 * dot(N, L) * N - L
+        Vec3Lanes viewDirection = Vec3Lanes::Normalize(Vec3Lanes::Set1(0.0f, 0.0f, 0.0f) - fragmentPosition);
+        Vec3Lanes reflectDirection = normal * (normalDotLight * FloatLanes::Set1(2.0f)) - lightDirection;
+        FloatLanes specularPower = power(FloatLanes::Max(Vec3Lanes::Dot(viewDirection, reflectDirection), FloatLanes::Set1(0.0f)), light.Shininess);
+        Vec3Lanes specularColor = Vec3Lanes::Set1(light.Specular.x, light.Specular.y, light.Specular.z) * specularPower * specularTexel;
+
+        FloatLanes lightFragmentDistance = Vec3Lanes::Length(toLight);
+        FloatLanes attenuation = FloatLanes::Set1(1.0f) / (FloatLanes::Set1(light.AttenuationConstantTerm)
+            + FloatLanes::Set1(light.AttenuationLinearTerm) * lightFragmentDistance
+            + FloatLanes::Set1(light.AttenuationQuadraticTerm) * lightFragmentDistance * lightFragmentDistance);
+
+        // negative light: diffuse and specular are subtracted from the ambient term
+        return ambientColor - diffuseColor * attenuation - specularColor * attenuation;
+    }
+
+    // base^exponent; integer exponents (the usual shininess values) use repeated squaring
+    static FloatLanes power(FloatLanes base, float exponent)
+    {
+        if (exponent >= 0.0f && exponent <= 1024.0f && exponent == std::floor(exponent))
+        {
+            FloatLanes result = FloatLanes::Set1(1.0f);
+            for (unsigned int bits = (unsigned int)exponent; bits != 0; bits >>= 1)
+            {
+                if (bits & 1)
+                    result *= base;
+                base *= base;
+            }
+            return result;
+        }
+        float values[FloatLanes::Count];
+        base.Store(values);
+        for (int lane = 0; lane < FloatLanes::Count; lane++)
+            values[lane] = std::pow(values[lane], exponent);
+        return FloatLanes::Load(values);
+    }
+
+    // bilinear sample with GL_REPEAT wrapping; texture rows are stored as uploaded by glTexImage2D (t = 0 first)
+    static Vec3Lanes sample(const Texture& texture, FloatLanes u, FloatLanes v)
+    {
+        const FloatLanes textureWidth = FloatLanes::Set1((float)texture.Width), textureHeight = FloatLanes::Set1((float)texture.Height);
+        FloatLanes x = u * textureWidth - FloatLanes::Set1(0.5f);
+        FloatLanes y = v * textureHeight - FloatLanes::Set1(0.5f);
+        FloatLanes x0 = FloatLanes::Floor(x), y0 = FloatLanes::Floor(y);
+        FloatLanes fractionX = x - x0, fractionY = y - y0;
+
+        // wrap into [0, size), then clamp what rounding (or a NaN, which Max turns into 0) leaves outside
+        x0 = x0 - textureWidth * FloatLanes::Floor(x0 / textureWidth);
+        y0 = y0 - textureHeight * FloatLanes::Floor(y0 / textureHeight);
+        x0 = FloatLanes::Min(FloatLanes::Max(x0, FloatLanes::Set1(0.0f)), FloatLanes::Set1((float)(texture.Width - 1)));
+        y0 = FloatLanes::Min(FloatLanes::Max(y0, FloatLanes::Set1(0.0f)), FloatLanes::Set1((float)(texture.Height - 1)));
+        FloatLanes x1 = x0 + FloatLanes::Set1(1.0f), y1 = y0 + FloatLanes::Set1(1.0f);
+        x1 = FloatLanes::Select(FloatLanes::GreaterEqual(x1, textureWidth), FloatLanes::Set1(0.0f), x1);
+        y1 = FloatLanes::Select(FloatLanes::GreaterEqual(y1, textureHeight), FloatLanes::Set1(0.0f), y1);
+
+        Vec3Lanes texel00 = fetch(texture, y0 * textureWidth + x0);
+        Vec3Lanes texel10 = fetch(texture, y0 * textureWidth + x1);
+        Vec3Lanes texel01 = fetch(texture, y1 * textureWidth + x0);
+        Vec3Lanes texel11 = fetch(texture, y1 * textureWidth + x1);
+
+        Vec3Lanes top = texel00 + (texel10 - texel00) * fractionX;
+        Vec3Lanes bottom = texel01 + (texel11 - texel01) * fractionX;
+        return top + (bottom - top) * fractionY;
+    }
+
+    // RGB of the texels at the given (integral) indices, in [0, 1]
+    static Vec3Lanes fetch(const Texture& texture, FloatLanes index)
+    {
+        const FloatLanes toUnit = FloatLanes::Set1(1.0f / 255.0f);
+#if defined(FLOAT_LANES_AVX2)
+        __m256i texels = _mm256_i32gather_epi32(reinterpret_cast<const int*>(texture.Texels.data()), _mm256_cvttps_epi32(index.v), 4);
+        const __m256i byteMask = _mm256_set1_epi32(0xff);
+        Vec3Lanes result = {
+            FloatLanes(_mm256_cvtepi32_ps(_mm256_and_si256(texels, byteMask))) * toUnit,
+            FloatLanes(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 8), byteMask))) * toUnit,
+            FloatLanes(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 16), byteMask))) * toUnit
+        };
+        return result;
+#else
+        float indices[FloatLanes::Count], red[FloatLanes::Count], green[FloatLanes::Count], blue[FloatLanes::Count];
+        index.Store(indices);
+        for (int lane = 0; lane < FloatLanes::Count; lane++)
+        {
+            std::uint32_t texel = texture.Texels[(size_t)indices[lane]];
+            red[lane] = (float)(texel & 0xff);
+            green[lane] = (float)((texel >> 8) & 0xff);
+            blue[lane] = (float)((texel >> 16) & 0xff);
+        }
+        Vec3Lanes result = { FloatLanes::Load(red) * toUnit, FloatLanes::Load(green) * toUnit, FloatLanes::Load(blue) * toUnit };
+        return result;
+#endif
+    }
+
+    static unsigned char toByte(float value)
+    {
+        return (unsigned char)(value * 255.0f + 0.5f);
+    }
+};
+#endif
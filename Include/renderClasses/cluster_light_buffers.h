@@ -0,0 +1,80 @@
+#pragma once
+#ifndef CLUSTER_LIGHT_BUFFERS_H
+#define CLUSTER_LIGHT_BUFFERS_H
+
+#include <glad/glad.h>
+
+#include <renderClasses/gl_state_cache.h>
+#include <sceneClasses/light_cluster_grid.h>
+
+#include <vector>
+
+// GPU side of the LightClusterGrid: three buffer textures read by mainCubeFragmentShader.glsl with texelFetch
+// (GL 3.3 has no shader storage buffers).
+//   clusterRecords       RG32UI,  one texel per froxel: first index, light count
+//   clusterLightIndices  R32UI,   the concatenated per-froxel light lists
+//   pointLights          RGBA32F, two texels per light: view-space position and radius, signed color
+// They stay bound to consecutive texture units from `firstTextureUnit`, in that order: the per-frame uploads
+// rebind a texture to its own unit to respecify it, so Bind only has work after something else used those units.
+class ClusterLightBuffers
+{
+public:
+    explicit ClusterLightBuffers(unsigned int firstTextureUnit) : firstTextureUnit(firstTextureUnit)
+    {
+        glGenBuffers(BUFFER_COUNT, buffers);
+        glGenTextures(BUFFER_COUNT, textures);
+        // start with valid (empty) contents so the shader can run before the first Upload
+        LightClusterGrid::ClusterRecord emptyRecords[LightClusterGrid::ClusterCount] = {};
+        std::uint32_t noIndex = 0;
+        float noLight[8] = {};
+        GlStateCache state;
+        upload(state, RECORDS, GL_RG32UI, sizeof(emptyRecords), emptyRecords);
+        upload(state, INDICES, GL_R32UI, sizeof(noIndex), &noIndex);
+        upload(state, LIGHTS, GL_RGBA32F, sizeof(noLight), noLight);
+    }
+
+    ClusterLightBuffers(const ClusterLightBuffers&) = delete;
+    ClusterLightBuffers& operator=(const ClusterLightBuffers&) = delete;
+
+    ~ClusterLightBuffers()
+    {
+        glDeleteTextures(BUFFER_COUNT, textures);
+        glDeleteBuffers(BUFFER_COUNT, buffers);
+    }
+
+    // streams this frame's grid; the previous storage is orphaned so the upload never waits on the GPU
+    void Upload(const LightClusterGrid& grid, GlStateCache& state)
+    {
+        upload(state, RECORDS, GL_RG32UI, grid.Records.size() * sizeof(LightClusterGrid::ClusterRecord), grid.Records.data());
+        if (!grid.LightIndices.empty())
+            upload(state, INDICES, GL_R32UI, grid.LightIndices.size() * sizeof(std::uint32_t), grid.LightIndices.data());
+        if (!grid.Lights.empty())
+            upload(state, LIGHTS, GL_RGBA32F, grid.Lights.size() * sizeof(LightClusterGrid::ViewSpaceLight), grid.Lights.data());
+    }
+
+    // binds the three buffer textures to their texture units
+    void Bind(GlStateCache& state) const
+    {
+        for (int i = 0; i < BUFFER_COUNT; i++)
+            state.BindTexture(firstTextureUnit + i, GL_TEXTURE_BUFFER, textures[i]);
+    }
+
+private:
+    enum { RECORDS, INDICES, LIGHTS, BUFFER_COUNT };
+    unsigned int buffers[BUFFER_COUNT];
+    unsigned int textures[BUFFER_COUNT];
+    unsigned int firstTextureUnit;
+
+    void upload(GlStateCache& state, int buffer, GLenum format, size_t size, const void* data)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[buffer]);
+        glBufferData(GL_TEXTURE_BUFFER, size, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+        // glTexBuffer edits the texture bound to the active unit
+        state.ActiveTexture(firstTextureUnit + buffer);
+        state.BindTexture(firstTextureUnit + buffer, GL_TEXTURE_BUFFER, textures[buffer]);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffers[buffer]);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+};
+#endif
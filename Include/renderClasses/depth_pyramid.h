@@ -0,0 +1,225 @@
+#pragma once
+#ifndef DEPTH_PYRAMID_H
+#define DEPTH_PYRAMID_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <sceneClasses/occlusion_culler.h>
+#include <shaderClasses/shader_s.h>
+
+#include <algorithm>
+
+// GPU side of hierarchical-Z occlusion culling. After the scene is drawn, Build() copies the depth buffer into a
+// texture and reduces it, with depthPyramidFragmentShader.glsl, into the levels of an R32F pyramid whose texels keep
+// the farthest depth below them, down to the first level at most ReadbackSize texels wide and tall. That level is
+// read into a pixel pack buffer, and Readback() hands it to the OcclusionCuller a frame later, only once its fence
+// has signaled: the GPU is never waited for, the culler keeps older depth instead.
+// GL 3.3 has no compute shaders, so each level is one fullscreen-triangle pass into a level of the pyramid texture;
+// the source level is isolated with GL_TEXTURE_BASE_LEVEL/MAX_LEVEL so no pass reads the level it writes.
+class DepthPyramid
+{
+public:
+    static const int ReadbackSize = 160;
+
+    DepthPyramid() : width(0), height(0), levelCount(0), depthTexture(0), pyramidTexture(0), framebuffer(0), emptyVertexArray(0), nextSlot(0)
+    {
+        glGenFramebuffers(1, &framebuffer);
+        glGenVertexArrays(1, &emptyVertexArray);
+        glGenBuffers(SLOT_COUNT, packBuffers);
+        for (int slot = 0; slot < SLOT_COUNT; slot++)
+            slots[slot].Fence = 0;
+    }
+
+    DepthPyramid(const DepthPyramid&) = delete;
+    DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+    ~DepthPyramid()
+    {
+        for (int slot = 0; slot < SLOT_COUNT; slot++)
+        {
+            if (slots[slot].Fence)
+                glDeleteSync(slots[slot].Fence);
+        }
+        glDeleteBuffers(SLOT_COUNT, packBuffers);
+        glDeleteVertexArrays(1, &emptyVertexArray);
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteTextures(1, &depthTexture);
+        glDeleteTextures(1, &pyramidTexture);
+    }
+
+    // reduces the depth of `sourceFramebuffer` (0: the window) drawn with `viewProjection`, and queues the readback.
+    // Leaves `sourceFramebuffer` bound with a full viewport and depth testing on; the program, vertex array and the
+    // texture bound to unit 0 change.
+    void Build(Shader& downsampleShader, unsigned int sourceFramebuffer, int framebufferWidth, int framebufferHeight, const glm::mat4& viewProjection)
+    {
+        resize(framebufferWidth, framebufferHeight);
+        Slot& slot = slots[nextSlot];
+        if (slot.Fence)
+        {
+            // not read back yet (the GPU is more than a frame behind): overwritten
+            glDeleteSync(slot.Fence);
+            slot.Fence = 0;
+        }
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, sourceFramebuffer);
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glDisable(GL_DEPTH_TEST);
+        downsampleShader.use();
+        glBindVertexArray(emptyVertexArray);
+        int levelWidth = width, levelHeight = height;
+        for (int level = 0; level < levelCount; level++)
+        {
+            levelWidth = std::max(levelWidth / 2, 1);
+            levelHeight = std::max(levelHeight / 2, 1);
+            if (level == 0)
+                glBindTexture(GL_TEXTURE_2D, depthTexture);
+            else
+            {
+                glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+            }
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramidTexture, level);
+            glViewport(0, 0, levelWidth, levelHeight);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+
+        // the last level, into this frame's pack buffer: glReadPixels returns without waiting
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffers[nextSlot]);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glReadPixels(0, 0, levelWidth, levelHeight, GL_RED, GL_FLOAT, NULL);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.Width = levelWidth;
+        slot.Height = levelHeight;
+        slot.ViewProjection = viewProjection;
+        nextSlot = (nextSlot + 1) % SLOT_COUNT;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, sourceFramebuffer);
+        glViewport(0, 0, width, height);
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    // passes the most recent finished readback to the culler; false when none finished since the last call
+    bool Readback(OcclusionCuller& culler)
+    {
+        // newest first
+        for (int age = 1; age <= SLOT_COUNT; age++)
+        {
+            Slot& slot = slots[(nextSlot + SLOT_COUNT - age) % SLOT_COUNT];
+            if (!slot.Fence)
+                continue;
+            GLenum status = glClientWaitSync(slot.Fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                continue;
+
+            int slotIndex = (int)(&slot - slots);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffers[slotIndex]);
+            const float* depth = (const float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (size_t)slot.Width * slot.Height * sizeof(float), GL_MAP_READ_BIT);
+            if (depth)
+                culler.SetDepth(depth, slot.Width, slot.Height, levelCount, width, height, slot.ViewProjection);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            // this readback and any older one are used up
+            for (int slotToClear = 0; slotToClear < SLOT_COUNT; slotToClear++)
+            {
+                if (slots[slotToClear].Fence && (slotToClear == slotIndex || isOlder(slotToClear, slotIndex)))
+                {
+                    glDeleteSync(slots[slotToClear].Fence);
+                    slots[slotToClear].Fence = 0;
+                }
+            }
+            return depth != NULL;
+        }
+        return false;
+    }
+
+private:
+    // two readbacks in flight: the one queued this frame and the previous one
+    enum { SLOT_COUNT = 2 };
+
+    struct Slot
+    {
+        GLsync Fence; // 0 when nothing is pending
+        int Width, Height;
+        glm::mat4 ViewProjection;
+    };
+
+    int width, height;
+    int levelCount; // pyramid levels built, the last one read back
+    unsigned int depthTexture, pyramidTexture;
+    unsigned int framebuffer;
+    unsigned int emptyVertexArray;
+    unsigned int packBuffers[SLOT_COUNT];
+    Slot slots[SLOT_COUNT];
+    int nextSlot;
+
+    bool isOlder(int slot, int than) const
+    {
+        return (slot - nextSlot + SLOT_COUNT) % SLOT_COUNT < (than - nextSlot + SLOT_COUNT) % SLOT_COUNT;
+    }
+
+    // (re)creates the textures and pack buffers for a framebuffer size
+    void resize(int framebufferWidth, int framebufferHeight)
+    {
+        if (framebufferWidth == width && framebufferHeight == height)
+            return;
+        width = framebufferWidth;
+        height = framebufferHeight;
+
+        // the same format as the depth buffers of the window and of OffscreenFramebuffer, as the copy requires
+        glDeleteTextures(1, &depthTexture);
+        glGenTextures(1, &depthTexture);
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+        setNearestFiltering();
+
+        levelCount = 0;
+        int levelWidth = width, levelHeight = height;
+        while (levelCount == 0 || levelWidth > ReadbackSize || levelHeight > ReadbackSize)
+        {
+            levelWidth = std::max(levelWidth / 2, 1);
+            levelHeight = std::max(levelHeight / 2, 1);
+            levelCount++;
+        }
+        glDeleteTextures(1, &pyramidTexture);
+        glGenTextures(1, &pyramidTexture);
+        glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+        levelWidth = width;
+        levelHeight = height;
+        for (int level = 0; level < levelCount; level++)
+        {
+            levelWidth = std::max(levelWidth / 2, 1);
+            levelHeight = std::max(levelHeight / 2, 1);
+            glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, levelWidth, levelHeight, 0, GL_RED, GL_FLOAT, NULL);
+        }
+        setNearestFiltering();
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        for (int slot = 0; slot < SLOT_COUNT; slot++)
+        {
+            if (slots[slot].Fence)
+            {
+                glDeleteSync(slots[slot].Fence);
+                slots[slot].Fence = 0;
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffers[slot]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)levelWidth * levelHeight * sizeof(float), NULL, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    static void setNearestFiltering()
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+};
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// whether the current context advertises an extension; the generated glad loader knows none of them
+inline bool hasGLExtension(const char* name)
+{
+    int extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (int i = 0; i < extensionCount; i++)
+    {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, (GLuint)i));
+        if (extension != NULL && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+#endif
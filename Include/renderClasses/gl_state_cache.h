@@ -0,0 +1,207 @@
+#pragma once
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <ostream>
+
+// Remembers the GL state set through it (program, vertex array, active texture unit, texture per unit and target,
+// depth and blend state) and drops the calls that would set it to what it already is, counting both kinds.
+// The cache only knows what went through it: after code that changes that state with GL calls of its own (a
+// helper class binding its program or textures), the matching Invalidate call makes the next call go to GL again.
+// Everything starts unknown, so the first call of each kind is always issued.
+class GlStateCache
+{
+public:
+    // texture units tracked; a bind to a higher unit is always issued
+    static const unsigned int TextureUnitCount = 8;
+
+    GlStateCache() : issuedCalls(0), skippedCalls(0)
+    {
+        Invalidate();
+    }
+
+    void UseProgram(unsigned int program)
+    {
+        if (track(currentProgram, program))
+            glUseProgram(program);
+    }
+
+    void BindVertexArray(unsigned int vertexArray)
+    {
+        if (track(currentVertexArray, vertexArray))
+            glBindVertexArray(vertexArray);
+    }
+
+    void ActiveTexture(unsigned int unit)
+    {
+        if (track(activeUnit, unit))
+            glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    // selects `unit` only when the binding changes: call ActiveTexture first to edit the bound texture.
+    // A bind already in place also drops the glActiveTexture that would have come with it.
+    void BindTexture(unsigned int unit, GLenum target, unsigned int texture)
+    {
+        int targetIndex = textureTargetIndex(target);
+        if (unit < TextureUnitCount && targetIndex >= 0)
+        {
+            if (!track(boundTextures[unit][targetIndex], texture))
+            {
+                skippedCalls++;
+                return;
+            }
+        }
+        else
+            issuedCalls++;
+        ActiveTexture(unit);
+        glBindTexture(target, texture);
+    }
+
+    void SetDepthTest(bool enabled)
+    {
+        if (track(depthTest, enabled ? 1u : 0u))
+        {
+            if (enabled)
+                glEnable(GL_DEPTH_TEST);
+            else
+                glDisable(GL_DEPTH_TEST);
+        }
+    }
+
+    void SetDepthFunc(GLenum function)
+    {
+        if (track(depthFunc, function))
+            glDepthFunc(function);
+    }
+
+    void SetDepthMask(bool writeDepth)
+    {
+        if (track(depthMask, writeDepth ? 1u : 0u))
+            glDepthMask(writeDepth ? GL_TRUE : GL_FALSE);
+    }
+
+    // all four channels at once
+    void SetColorMask(bool writeColor)
+    {
+        if (track(colorMask, writeColor ? 1u : 0u))
+        {
+            GLboolean mask = writeColor ? GL_TRUE : GL_FALSE;
+            glColorMask(mask, mask, mask, mask);
+        }
+    }
+
+    void SetBlend(bool enabled)
+    {
+        if (track(blend, enabled ? 1u : 0u))
+        {
+            if (enabled)
+                glEnable(GL_BLEND);
+            else
+                glDisable(GL_BLEND);
+        }
+    }
+
+    void SetBlendFunc(GLenum sourceFactor, GLenum destinationFactor)
+    {
+        if (sourceFactor == blendSource && destinationFactor == blendDestination)
+        {
+            skippedCalls++;
+            return;
+        }
+        blendSource = sourceFactor;
+        blendDestination = destinationFactor;
+        issuedCalls++;
+        glBlendFunc(sourceFactor, destinationFactor);
+    }
+
+    // forgets everything, e.g. after a pass that sets its state with raw GL calls
+    void Invalidate()
+    {
+        InvalidateProgram();
+        currentVertexArray = UNKNOWN;
+        InvalidateTextures();
+        depthTest = depthFunc = depthMask = colorMask = UNKNOWN;
+        blend = blendSource = blendDestination = UNKNOWN;
+    }
+
+    void InvalidateProgram()
+    {
+        currentProgram = UNKNOWN;
+    }
+
+    // the active unit and every binding
+    void InvalidateTextures()
+    {
+        activeUnit = UNKNOWN;
+        for (unsigned int unit = 0; unit < TextureUnitCount; unit++)
+        {
+            for (int target = 0; target < TARGET_COUNT; target++)
+                boundTextures[unit][target] = UNKNOWN;
+        }
+    }
+
+    // GL calls made and dropped since the last ResetCounters
+    unsigned long long IssuedCalls() const
+    {
+        return issuedCalls;
+    }
+
+    unsigned long long SkippedCalls() const
+    {
+        return skippedCalls;
+    }
+
+    void ResetCounters()
+    {
+        issuedCalls = 0;
+        skippedCalls = 0;
+    }
+
+    // the counters as per-frame averages over `frameCount` frames
+    void PrintCounters(std::ostream& out, size_t frameCount) const
+    {
+        if (frameCount == 0)
+            return;
+        out << "GL state: " << (double)issuedCalls / frameCount << " calls issued and " << (double)skippedCalls / frameCount
+            << " redundant ones dropped per frame" << std::endl;
+    }
+
+private:
+    // no GL name or enum uses it
+    static const unsigned int UNKNOWN = 0xFFFFFFFFu;
+    enum { TARGET_2D, TARGET_BUFFER, TARGET_COUNT };
+
+    unsigned int currentProgram;
+    unsigned int currentVertexArray;
+    unsigned int activeUnit;
+    unsigned int boundTextures[TextureUnitCount][TARGET_COUNT];
+    unsigned int depthTest, depthFunc, depthMask, colorMask;
+    unsigned int blend, blendSource, blendDestination;
+    unsigned long long issuedCalls;
+    unsigned long long skippedCalls;
+
+    // true (and the new value recorded) when the GL call must be made
+    bool track(unsigned int& current, unsigned int value)
+    {
+        if (current == value)
+        {
+            skippedCalls++;
+            return false;
+        }
+        current = value;
+        issuedCalls++;
+        return true;
+    }
+
+    static int textureTargetIndex(GLenum target)
+    {
+        if (target == GL_TEXTURE_2D)
+            return TARGET_2D;
+        if (target == GL_TEXTURE_BUFFER)
+            return TARGET_BUFFER;
+        return -1;
+    }
+};
+#endif
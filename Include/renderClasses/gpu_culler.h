@@ -0,0 +1,144 @@
+#pragma once
+#ifndef GPU_CULLER_H
+#define GPU_CULLER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <meshClasses/mesh_buffers.h>
+#include <sceneClasses/cube_field.h>
+#include <sceneClasses/frustum_culler.h>
+#include <shaderClasses/shader_s.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// GPU-driven drawing of the scene objects (OpenGL 4.3): their bounding spheres and world transforms are uploaded
+// once into shader storage buffers, frustumCullComputeShader.glsl tests one sphere per invocation and appends the
+// survivors to a list of visible objects, counting them in the instance count of an indirect draw command, and
+// one glDrawElementsIndirect draws them with mainCubeGpuDrivenVertexShader.glsl fetching each instance's transform
+// through that list. Per frame the CPU writes the six frustum planes and a zero, whatever the number of objects.
+//   binding 0  ObjectBounds      vec4 per object: world-space center, radius
+//   binding 1  ObjectTransforms  GpuObjectTransform per object
+//   binding 2  VisibleObjects    uint per visible object (written by the compute shader)
+//   binding 3  DrawCommand       the DrawElementsIndirectCommand below
+class GpuCuller
+{
+public:
+    enum Binding { BOUNDS_BINDING, TRANSFORMS_BINDING, VISIBLE_BINDING, COMMAND_BINDING };
+    // must match local_size_x in frustumCullComputeShader.glsl
+    static const unsigned int WorkgroupSize = 64;
+
+    // the layout glDrawElementsIndirect reads
+    struct DrawElementsIndirectCommand
+    {
+        GLuint Count;
+        GLuint InstanceCount;
+        GLuint FirstIndex;
+        GLint BaseVertex;
+        GLuint BaseInstance;
+    };
+
+    // std430 layout of `struct ObjectTransform { mat4; mat3; }`: mat3 columns take 16 bytes each
+    struct GpuObjectTransform
+    {
+        float ModelMatrix[16];
+        float NormalMatrix[12];
+    };
+
+    // whether the current context has compute shaders and indirect draws
+    static bool Supported()
+    {
+        return GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 3);
+    }
+
+    GpuCuller(const std::vector<CubeInstance>& instances, float localRadius, const MeshBuffers& mesh) : objectCount((unsigned int)instances.size())
+    {
+        std::vector<glm::vec4> bounds(instances.size());
+        std::vector<GpuObjectTransform> transforms(instances.size());
+        for (size_t i = 0; i < instances.size(); i++)
+        {
+            bounds[i] = boundingSphere(instances[i].ModelMatrix, localRadius);
+            std::memcpy(transforms[i].ModelMatrix, glm::value_ptr(instances[i].ModelMatrix), sizeof(transforms[i].ModelMatrix));
+            for (int column = 0; column < 3; column++)
+            {
+                std::memcpy(transforms[i].NormalMatrix + column * 4, glm::value_ptr(instances[i].NormalMatrix[column]), 3 * sizeof(float));
+                transforms[i].NormalMatrix[column * 4 + 3] = 0.0f;
+            }
+        }
+
+        glGenBuffers(BUFFER_COUNT, buffers);
+        // empty storage buffers cannot be bound: keep at least one element
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[BOUNDS_BINDING]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(bounds.size(), 1) * sizeof(glm::vec4), bounds.empty() ? NULL : bounds.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[TRANSFORMS_BINDING]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(transforms.size(), 1) * sizeof(GpuObjectTransform), transforms.empty() ? NULL : transforms.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[VISIBLE_BINDING]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(instances.size(), 1) * sizeof(std::uint32_t), NULL, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        indexType = mesh.IndexType();
+        DrawElementsIndirectCommand command = { mesh.IndexCount(), 0, 0, 0, 0 };
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffers[COMMAND_BINDING]);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(command), &command, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    GpuCuller(const GpuCuller&) = delete;
+    GpuCuller& operator=(const GpuCuller&) = delete;
+
+    ~GpuCuller()
+    {
+        glDeleteBuffers(BUFFER_COUNT, buffers);
+    }
+
+    // rebuilds the visible list and the draw command for this frame's camera; leaves cullProgram in use
+    void Cull(Shader& cullProgram, const glm::mat4& viewProjection)
+    {
+        static constexpr UniformHandle frustumPlanes("frustumPlanes");
+        static constexpr UniformHandle objectCountUniform("objectCount");
+
+        glm::vec4 planes[6];
+        FrustumCuller::ExtractPlanes(viewProjection, planes);
+        cullProgram.use();
+        glUniform4fv(cullProgram.location(frustumPlanes), 6, glm::value_ptr(planes[0]));
+        cullProgram.setInt(objectCountUniform, (int)objectCount);
+
+        // the compute shader counts the visible objects from zero
+        const GLuint noInstance = 0;
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffers[COMMAND_BINDING]);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, offsetof(DrawElementsIndirectCommand, InstanceCount), sizeof(noInstance), &noInstance);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        bindStorage();
+        glDispatchCompute((objectCount + WorkgroupSize - 1) / WorkgroupSize, 1, 1);
+        // the draw reads the command and the vertex shader the visible list
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // draws the visible objects with the bound program and vertex array
+    void Draw() const
+    {
+        bindStorage();
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffers[COMMAND_BINDING]);
+        glDrawElementsIndirect(GL_TRIANGLES, indexType, NULL);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+private:
+    enum { BUFFER_COUNT = 4 };
+    unsigned int buffers[BUFFER_COUNT];
+    unsigned int objectCount;
+    GLenum indexType;
+
+    void bindStorage() const
+    {
+        for (unsigned int binding = 0; binding < BUFFER_COUNT; binding++)
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffers[binding]);
+    }
+};
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef OFFSCREEN_FRAMEBUFFER_H
+#define OFFSCREEN_FRAMEBUFFER_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+// A color + depth framebuffer object used as render target when there is no visible window to present to
+class OffscreenFramebuffer
+{
+public:
+    unsigned int ID;
+    int Width;
+    int Height;
+
+    OffscreenFramebuffer(int width, int height) : ID(0), Width(width), Height(height), colorRenderbuffer(0), depthRenderbuffer(0)
+    {
+        glGenFramebuffers(1, &ID);
+        glBindFramebuffer(GL_FRAMEBUFFER, ID);
+
+        glGenRenderbuffers(1, &colorRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRenderbuffer);
+
+        glGenRenderbuffers(1, &depthRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER::NOT_COMPLETE" << std::endl;
+
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    OffscreenFramebuffer(const OffscreenFramebuffer&) = delete;
+    OffscreenFramebuffer& operator=(const OffscreenFramebuffer&) = delete;
+
+    ~OffscreenFramebuffer()
+    {
+        glDeleteRenderbuffers(1, &colorRenderbuffer);
+        glDeleteRenderbuffers(1, &depthRenderbuffer);
+        glDeleteFramebuffers(1, &ID);
+    }
+
+    // render into this framebuffer from now on
+    void bind() const
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, ID);
+        glViewport(0, 0, Width, Height);
+    }
+
+private:
+    unsigned int colorRenderbuffer;
+    unsigned int depthRenderbuffer;
+};
+#endif
@@ -0,0 +1,126 @@
+#pragma once
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Orders a frame's draws by a packed 64-bit key, radix-sorted:
+//   bits 63-56  program        bits 55-48  vertex array
+//   bits 47-32  texture        bits 31-0   view-space depth (the bits of a non-negative float)
+// Draws sharing a program, vertex array and texture end up next to each other, so state only changes between
+// groups, and within a group they go nearest first, so the depth test rejects what lies behind already drawn
+// objects before it is shaded. GL names wider than their field wrap: two states may then share a group, which only
+// costs some grouping, since the caller binds the state of each item anyway.
+// The sort is a least significant digit radix sort on bytes, stable, skipping the bytes every key shares (such as
+// the state bytes when everything uses the same program); its buffers are kept between frames.
+class RenderQueue
+{
+public:
+    struct Item
+    {
+        std::uint64_t Key;
+        std::uint32_t Object; // caller-defined, such as a scene object index
+    };
+
+    static bool Enabled()
+    {
+        return enabledSetting();
+    }
+
+    static void SetEnabled(bool enabled)
+    {
+        enabledSetting() = enabled;
+    }
+
+    // `viewDepth`: distance in front of the camera, along its forward axis (clamped to 0 behind it)
+    static std::uint64_t MakeKey(unsigned int program, unsigned int vertexArray, unsigned int texture, float viewDepth)
+    {
+        if (!(viewDepth > 0.0f))
+            viewDepth = 0.0f;
+        // IEEE 754 floats of the same sign order like their bit patterns
+        std::uint32_t depthBits;
+        std::memcpy(&depthBits, &viewDepth, sizeof(depthBits));
+        return ((std::uint64_t)(program & 0xFFu) << 56) | ((std::uint64_t)(vertexArray & 0xFFu) << 48)
+            | ((std::uint64_t)(texture & 0xFFFFu) << 32) | depthBits;
+    }
+
+    // the program, vertex array and texture part of a key: a new group starts where it changes
+    static std::uint32_t StateOf(std::uint64_t key)
+    {
+        return (std::uint32_t)(key >> 32);
+    }
+
+    void Clear()
+    {
+        items.clear();
+    }
+
+    void Push(std::uint64_t key, std::uint32_t object)
+    {
+        Item item = { key, object };
+        items.push_back(item);
+    }
+
+    void Sort()
+    {
+        const size_t count = items.size();
+        scratch.resize(count);
+        // the histograms of all 8 bytes in one pass over the keys
+        std::memset(counts, 0, sizeof(counts));
+        for (const Item& item : items)
+        {
+            for (int digit = 0; digit < DIGIT_COUNT; digit++)
+                counts[digit][(item.Key >> (digit * 8)) & 0xFF]++;
+        }
+
+        for (int digit = 0; digit < DIGIT_COUNT; digit++)
+        {
+            // every key has the same byte here: the pass would not move anything
+            if (count == 0 || counts[digit][(items[0].Key >> (digit * 8)) & 0xFF] == count)
+                continue;
+            size_t offset = 0;
+            for (int value = 0; value < 256; value++)
+            {
+                size_t valueCount = counts[digit][value];
+                counts[digit][value] = offset;
+                offset += valueCount;
+            }
+            for (const Item& item : items)
+                scratch[counts[digit][(item.Key >> (digit * 8)) & 0xFF]++] = item;
+            items.swap(scratch);
+        }
+
+        objects.resize(count);
+        for (size_t i = 0; i < count; i++)
+            objects[i] = items[i].Object;
+    }
+
+    // sorted by Sort
+    const std::vector<Item>& Items() const
+    {
+        return items;
+    }
+
+    // the objects of Items(), in the same order
+    const std::vector<std::uint32_t>& Objects() const
+    {
+        return objects;
+    }
+
+private:
+    enum { DIGIT_COUNT = 8 };
+
+    std::vector<Item> items;
+    std::vector<Item> scratch;
+    std::vector<std::uint32_t> objects;
+    size_t counts[DIGIT_COUNT][256];
+
+    static bool& enabledSetting()
+    {
+        static bool enabled = true;
+        return enabled;
+    }
+};
+#endif
@@ -0,0 +1,101 @@
+#pragma once
+#ifndef CUBE_FIELD_H
+#define CUBE_FIELD_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+// Per-instance data of a cube, laid out exactly as it is streamed to the instance VBO
+struct CubeInstance
+{
+    glm::mat4 ModelMatrix;
+    // inverse-transpose of the model matrix's upper 3x3, in world space
+    glm::mat3 NormalMatrix;
+};
+
+// The set of textured cubes lit by the negative light.
+// The first ten are the hand-placed cubes of the original scene; any extra cube is laid out on a jittered grid behind them.
+class CubeField
+{
+public:
+    std::vector<glm::vec3> Positions;
+    std::vector<CubeInstance> Instances;
+
+    explicit CubeField(unsigned int count = 10)
+    {
+        static const glm::vec3 handPlacedPositions[] = {
+            glm::vec3(0.0f,  0.0f,  0.0f),
+            glm::vec3(2.0f,  5.0f, -15.0f),
+            glm::vec3(-1.5f, -2.2f, -2.5f),
+            glm::vec3(-3.8f, -2.0f, -12.3f),
+            glm::vec3(2.4f, -0.4f, -3.5f),
+            glm::vec3(-1.7f,  3.0f, -7.5f),
+            glm::vec3(1.3f, -2.0f, -2.5f),
+            glm::vec3(1.5f,  2.0f, -2.5f),
+            glm::vec3(1.5f,  0.2f, -1.5f),
+            glm::vec3(-1.3f,  1.0f, -1.5f)
+        };
+        const unsigned int handPlacedCount = sizeof(handPlacedPositions) / sizeof(handPlacedPositions[0]);
+
+        Positions.reserve(count);
+        Instances.reserve(count);
+
+        // side of the grid holding the extra cubes
+        const unsigned int extraCount = count > handPlacedCount ? count - handPlacedCount : 0;
+        const unsigned int gridSide = extraCount > 0 ? (unsigned int)std::ceil(std::cbrt((double)extraCount)) : 0;
+        const float spacing = 3.0f;
+        const float halfExtent = 0.5f * spacing * (float)(gridSide > 0 ? gridSide - 1 : 0);
+
+        for (unsigned int i = 0; i < count; i++)
+        {
+            glm::vec3 position;
+            if (i < handPlacedCount)
+            {
+                position = handPlacedPositions[i];
+            }
+            else
+            {
+                unsigned int gridIndex = i - handPlacedCount;
+                unsigned int x = gridIndex % gridSide;
+                unsigned int y = (gridIndex / gridSide) % gridSide;
+                unsigned int z = gridIndex / (gridSide * gridSide);
+                glm::vec3 jitter(hashToUnitFloat(i * 3u), hashToUnitFloat(i * 3u + 1u), hashToUnitFloat(i * 3u + 2u));
+                position = glm::vec3(x * spacing - halfExtent, y * spacing - halfExtent, -20.0f - z * spacing)
+                    + (jitter - 0.5f) * spacing * 0.5f;
+            }
+            Positions.push_back(position);
+
+            glm::mat4 model = glm::mat4(1.0f);
+            model = glm::translate(model, position);
+            float angle = 20.0f * i;
+            model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+
+            CubeInstance instance;
+            instance.ModelMatrix = model;
+            instance.NormalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+            Instances.push_back(instance);
+        }
+    }
+
+    unsigned int Count() const
+    {
+        return (unsigned int)Instances.size();
+    }
+
+private:
+    // deterministic pseudo-random value in [0, 1) so every run (and every benchmark) sees the same field
+    static float hashToUnitFloat(std::uint32_t value)
+    {
+        value ^= value >> 16;
+        value *= 0x7feb352dU;
+        value ^= value >> 15;
+        value *= 0x846ca68bU;
+        value ^= value >> 16;
+        return (value >> 8) * (1.0f / 16777216.0f);
+    }
+};
+#endif
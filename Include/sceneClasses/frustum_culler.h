@@ -0,0 +1,164 @@
+#pragma once
+#ifndef FRUSTUM_CULLER_H
+#define FRUSTUM_CULLER_H
+
+#include <glm/glm.hpp>
+
+#include <sceneClasses/cube_field.h>
+#include <simdClasses/float_lanes.h>
+#include <threadingClasses/worker_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// World-space bounding sphere (center, radius) of a mesh bounded by `localRadius` around its origin; the model
+// matrix may rotate and scale it
+inline glm::vec4 boundingSphere(const glm::mat4& model, float localRadius)
+{
+    float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    return glm::vec4(glm::vec3(model[3]), localRadius * scale);
+}
+
+// Keeps the objects whose bounding sphere touches the view frustum.
+// The spheres are stored one array per component, so a batch of FloatLanes::Count spheres is tested against the
+// six planes with a multiply-add and a compare per plane and no shuffle. The planes are the rows of
+// projection * view combined as by Gribb and Hartmann, normalized so that a plane's value at a sphere center is
+// the signed distance to compare with the radius. Spheres that straddle two planes near a frustum corner are kept,
+// which only costs a draw. Batches of objects are spread over the WorkerPool when one is given.
+class FrustumCuller
+{
+public:
+    // indices of the objects to draw, in increasing order
+    std::vector<std::uint32_t> Visible;
+
+    FrustumCuller() : objectCount(0) {}
+
+    static bool Enabled()
+    {
+        return enabledSetting();
+    }
+
+    static void SetEnabled(bool enabled)
+    {
+        enabledSetting() = enabled;
+    }
+
+    void SetObjects(const std::vector<CubeInstance>& instances, float localRadius)
+    {
+        objectCount = instances.size();
+        size_t paddedCount = (objectCount + FloatLanes::Count - 1) / FloatLanes::Count * FloatLanes::Count;
+        centerX.assign(paddedCount, 0.0f);
+        centerY.assign(paddedCount, 0.0f);
+        centerZ.assign(paddedCount, 0.0f);
+        radii.assign(paddedCount, 0.0f);
+        for (size_t i = 0; i < objectCount; i++)
+        {
+            glm::vec4 sphere = boundingSphere(instances[i].ModelMatrix, localRadius);
+            centerX[i] = sphere.x;
+            centerY[i] = sphere.y;
+            centerZ[i] = sphere.z;
+            radii[i] = sphere.w;
+        }
+        chunkVisible.resize((objectCount + ObjectsPerChunk - 1) / ObjectsPerChunk);
+        Visible.clear();
+        Visible.reserve(objectCount);
+    }
+
+    void Cull(const glm::mat4& viewProjection, WorkerPool* pool = NULL)
+    {
+        glm::vec4 planes[6];
+        ExtractPlanes(viewProjection, planes);
+
+        auto cullChunk = [&](size_t chunk) {
+            FloatLanes planeX[6], planeY[6], planeZ[6], planeW[6];
+            for (int p = 0; p < 6; p++)
+            {
+                planeX[p] = FloatLanes::Set1(planes[p].x);
+                planeY[p] = FloatLanes::Set1(planes[p].y);
+                planeZ[p] = FloatLanes::Set1(planes[p].z);
+                planeW[p] = FloatLanes::Set1(planes[p].w);
+            }
+            std::vector<std::uint32_t>& visible = chunkVisible[chunk];
+            visible.clear();
+            size_t end = std::min(objectCount, (chunk + 1) * ObjectsPerChunk);
+            for (size_t first = chunk * ObjectsPerChunk; first < end; first += FloatLanes::Count)
+            {
+                FloatLanes x = FloatLanes::Load(&centerX[first]);
+                FloatLanes y = FloatLanes::Load(&centerY[first]);
+                FloatLanes z = FloatLanes::Load(&centerZ[first]);
+                FloatLanes negativeRadius = FloatLanes::Set1(0.0f) - FloatLanes::Load(&radii[first]);
+                FloatLanes inside = FloatLanes::GreaterEqual(planeX[0] * x + planeY[0] * y + planeZ[0] * z + planeW[0], negativeRadius);
+                for (int p = 1; p < 6; p++)
+                    inside = FloatLanes::And(inside, FloatLanes::GreaterEqual(planeX[p] * x + planeY[p] * y + planeZ[p] * z + planeW[p], negativeRadius));
+                int mask = FloatLanes::MoveMask(inside);
+                // the padding lanes of the last batch
+                if (end - first < (size_t)FloatLanes::Count)
+                    mask &= (1 << (end - first)) - 1;
+                for (int lane = 0; mask != 0; lane++, mask >>= 1)
+                {
+                    if (mask & 1)
+                        visible.push_back((std::uint32_t)(first + lane));
+                }
+            }
+        };
+        if (pool)
+            pool->ParallelFor(chunkVisible.size(), cullChunk);
+        else
+        {
+            for (size_t chunk = 0; chunk < chunkVisible.size(); chunk++)
+                cullChunk(chunk);
+        }
+
+        Visible.clear();
+        for (const std::vector<std::uint32_t>& visible : chunkVisible)
+            Visible.insert(Visible.end(), visible.begin(), visible.end());
+    }
+
+    // left, right, bottom, top, near, far; a point is inside when dot(plane.xyz, point) + plane.w >= 0 for all six
+    static void ExtractPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6])
+    {
+        glm::vec4 rows[4];
+        for (int row = 0; row < 4; row++)
+            rows[row] = glm::vec4(viewProjection[0][row], viewProjection[1][row], viewProjection[2][row], viewProjection[3][row]);
+        for (int axis = 0; axis < 3; axis++)
+        {
+            planes[axis * 2] = rows[3] + rows[axis];
+            planes[axis * 2 + 1] = rows[3] - rows[axis];
+        }
+        for (int p = 0; p < 6; p++)
+            planes[p] /= glm::length(glm::vec3(planes[p]));
+    }
+
+    // world-space bounding sphere of an object: center, radius
+    glm::vec4 Sphere(std::uint32_t object) const
+    {
+        return glm::vec4(centerX[object], centerY[object], centerZ[object], radii[object]);
+    }
+
+    unsigned int VisibleCount() const
+    {
+        return (unsigned int)Visible.size();
+    }
+
+    unsigned int ObjectCount() const
+    {
+        return (unsigned int)objectCount;
+    }
+
+private:
+    // a multiple of every FloatLanes::Count, so that only the last chunk has a partial batch
+    static const size_t ObjectsPerChunk = 4096;
+
+    static bool& enabledSetting()
+    {
+        static bool enabled = true;
+        return enabled;
+    }
+
+    size_t objectCount;
+    std::vector<float> centerX, centerY, centerZ, radii;
+    std::vector<std::vector<std::uint32_t>> chunkVisible;
+};
+#endif
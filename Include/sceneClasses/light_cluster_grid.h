@@ -0,0 +1,239 @@
+#pragma once
+#ifndef LIGHT_CLUSTER_GRID_H
+#define LIGHT_CLUSTER_GRID_H
+
+#include <glm/glm.hpp>
+
+#include <sceneClasses/point_light_field.h>
+#include <simdClasses/float_lanes.h>
+#include <threadingClasses/worker_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Clustered light culling: the view frustum is split into a grid of froxels (screen tiles x depth slices,
+// the slices spaced exponentially between the near and far planes), and every froxel gets the list of the
+// point lights whose sphere touches it. The fragment shader finds its froxel from gl_FragCoord and its
+// view-space depth, and only shades the lights of that list.
+//
+// Build() runs one task per depth slice on the WorkerPool: a slice first keeps the lights overlapping its
+// depth range, then tests them against its froxels FloatLanes::Count lights at a time (sphere vs box).
+class LightClusterGrid
+{
+public:
+    static const unsigned int GridX = 16;
+    static const unsigned int GridY = 9;
+    static const unsigned int GridZ = 24;
+    static const unsigned int ClusterCount = GridX * GridY * GridZ;
+
+    // per froxel, in x-major then y then slice order: range of LightIndices
+    struct ClusterRecord
+    {
+        std::uint32_t FirstIndex;
+        std::uint32_t LightCount;
+    };
+
+    // per light, what the shader reads: view-space position and range, color (negated for negative lights)
+    struct ViewSpaceLight
+    {
+        glm::vec4 PositionRadius;
+        glm::vec4 SignedColor;
+    };
+
+    std::vector<ClusterRecord> Records;
+    std::vector<std::uint32_t> LightIndices;
+    std::vector<ViewSpaceLight> Lights;
+
+    LightClusterGrid() : Records(ClusterCount), projectionMatrix(0.0f), width(0), height(0), nearPlane(0.0f), farPlane(0.0f), sliceScale(0.0f), sliceBias(0.0f), boxes(ClusterCount), sliceResults(GridZ) {}
+
+    // recomputes the froxel boxes; cheap to call every frame, it only does work when something changed
+    void SetProjection(const glm::mat4& projectionMatrix, float nearPlane, float farPlane, unsigned int width, unsigned int height)
+    {
+        if (projectionMatrix == this->projectionMatrix && nearPlane == this->nearPlane && farPlane == this->farPlane
+            && width == this->width && height == this->height)
+            return;
+        this->projectionMatrix = projectionMatrix;
+        this->nearPlane = nearPlane;
+        this->farPlane = farPlane;
+        this->width = width;
+        this->height = height;
+
+        // slice = floor(log(depth) * sliceScale + sliceBias): 0 at the near plane, GridZ at the far plane
+        sliceScale = (float)GridZ / std::log(farPlane / nearPlane);
+        sliceBias = -(float)GridZ * std::log(nearPlane) / std::log(farPlane / nearPlane);
+
+        const glm::mat4 inverseProjection = glm::inverse(projectionMatrix);
+        const glm::vec2 tile = TileSize();
+        for (unsigned int z = 0; z < GridZ; z++)
+        {
+            float sliceNear = SliceDepth(z), sliceFar = SliceDepth(z + 1);
+            for (unsigned int y = 0; y < GridY; y++)
+            {
+                for (unsigned int x = 0; x < GridX; x++)
+                {
+                    Box& box = boxes[clusterIndex(x, y, z)];
+                    box.Min = glm::vec3(std::numeric_limits<float>::max());
+                    box.Max = glm::vec3(-std::numeric_limits<float>::max());
+                    // the 4 corner rays of the tile (window coordinates, origin at the bottom left like gl_FragCoord)
+                    for (int corner = 0; corner < 4; corner++)
+                    {
+                        float pixelX = (x + (corner & 1)) * tile.x, pixelY = (y + (corner >> 1)) * tile.y;
+                        glm::vec4 onNearPlane = inverseProjection * glm::vec4(2.0f * pixelX / width - 1.0f, 2.0f * pixelY / height - 1.0f, -1.0f, 1.0f);
+                        glm::vec3 ray = glm::vec3(onNearPlane) / onNearPlane.w;
+                        ray /= -ray.z;
+                        box.Min = glm::min(box.Min, glm::min(ray * sliceNear, ray * sliceFar));
+                        box.Max = glm::max(box.Max, glm::max(ray * sliceNear, ray * sliceFar));
+                    }
+                }
+            }
+        }
+    }
+
+    // assigns the lights to the froxels for this frame's camera
+    void Build(const std::vector<PointLight>& pointLights, const glm::mat4& viewMatrix, WorkerPool& pool)
+    {
+        // view-space lights, and the same data as padded structure-of-arrays for the SIMD tests
+        const size_t lightCount = pointLights.size();
+        const size_t paddedCount = (lightCount + FloatLanes::Count - 1) / FloatLanes::Count * FloatLanes::Count;
+        Lights.resize(lightCount);
+        centerX.assign(paddedCount, 1.0e18f);
+        centerY.assign(paddedCount, 1.0e18f);
+        centerZ.assign(paddedCount, 1.0e18f);
+        radius.assign(paddedCount, 0.0f);
+        for (size_t i = 0; i < lightCount; i++)
+        {
+            const PointLight& light = pointLights[i];
+            glm::vec3 position = glm::vec3(viewMatrix * glm::vec4(light.Position, 1.0f));
+            Lights[i].PositionRadius = glm::vec4(position, light.Radius);
+            Lights[i].SignedColor = glm::vec4(light.Negative ? -light.Color : light.Color, 0.0f);
+            centerX[i] = position.x;
+            centerY[i] = position.y;
+            centerZ[i] = position.z;
+            radius[i] = light.Radius;
+        }
+
+        pool.ParallelFor(GridZ, [&](size_t slice) { buildSlice((unsigned int)slice); });
+
+        // concatenate the slices, keeping the froxel order
+        LightIndices.clear();
+        for (unsigned int z = 0; z < GridZ; z++)
+        {
+            const SliceResult& result = sliceResults[z];
+            for (unsigned int i = 0; i < GridX * GridY; i++)
+            {
+                Records[z * GridX * GridY + i].FirstIndex = (std::uint32_t)LightIndices.size() + result.Records[i].FirstIndex;
+                Records[z * GridX * GridY + i].LightCount = result.Records[i].LightCount;
+            }
+            LightIndices.insert(LightIndices.end(), result.Indices.begin(), result.Indices.end());
+        }
+    }
+
+    // view-space depth of the near side of a slice
+    float SliceDepth(unsigned int slice) const
+    {
+        return nearPlane * std::pow(farPlane / nearPlane, (float)slice / (float)GridZ);
+    }
+
+    // slice = log(depth) * x + y
+    glm::vec2 SliceParameters() const
+    {
+        return glm::vec2(sliceScale, sliceBias);
+    }
+
+    // size of a screen tile in pixels; the last column and row of tiles may reach past the framebuffer
+    glm::vec2 TileSize() const
+    {
+        return glm::vec2(std::ceil((float)width / GridX), std::ceil((float)height / GridY));
+    }
+
+private:
+    struct Box
+    {
+        glm::vec3 Min, Max;
+    };
+
+    struct SliceResult
+    {
+        std::vector<ClusterRecord> Records; // FirstIndex relative to Indices
+        std::vector<std::uint32_t> Indices;
+        std::vector<std::uint32_t> Candidates;
+        std::vector<float> CandidateX, CandidateY, CandidateZ, CandidateRadiusSquared;
+    };
+
+    glm::mat4 projectionMatrix;
+    unsigned int width, height;
+    float nearPlane, farPlane;
+    float sliceScale, sliceBias;
+    std::vector<Box> boxes;
+    std::vector<float> centerX, centerY, centerZ, radius;
+    std::vector<SliceResult> sliceResults;
+
+    static unsigned int clusterIndex(unsigned int x, unsigned int y, unsigned int z)
+    {
+        return x + GridX * (y + GridY * z);
+    }
+
+    void buildSlice(unsigned int slice)
+    {
+        SliceResult& result = sliceResults[slice];
+        result.Records.resize(GridX * GridY);
+        result.Indices.clear();
+
+        // lights whose depth range overlaps the slice (view space looks down -z)
+        const float sliceNear = SliceDepth(slice), sliceFar = SliceDepth(slice + 1);
+        result.Candidates.clear();
+        const size_t lightCount = Lights.size();
+        for (size_t i = 0; i < lightCount; i++)
+        {
+            float depth = -centerZ[i];
+            if (depth + radius[i] >= sliceNear && depth - radius[i] <= sliceFar)
+                result.Candidates.push_back((std::uint32_t)i);
+        }
+        const size_t candidateCount = result.Candidates.size();
+        const size_t paddedCount = (candidateCount + FloatLanes::Count - 1) / FloatLanes::Count * FloatLanes::Count;
+        result.CandidateX.assign(paddedCount, 1.0e18f);
+        result.CandidateY.assign(paddedCount, 1.0e18f);
+        result.CandidateZ.assign(paddedCount, 1.0e18f);
+        result.CandidateRadiusSquared.assign(paddedCount, 0.0f);
+        for (size_t c = 0; c < candidateCount; c++)
+        {
+            std::uint32_t i = result.Candidates[c];
+            result.CandidateX[c] = centerX[i];
+            result.CandidateY[c] = centerY[i];
+            result.CandidateZ[c] = centerZ[i];
+            result.CandidateRadiusSquared[c] = radius[i] * radius[i];
+        }
+
+        const FloatLanes zero = FloatLanes::Set1(0.0f);
+        for (unsigned int tile = 0; tile < GridX * GridY; tile++)
+        {
+            const Box& box = boxes[slice * GridX * GridY + tile];
+            const FloatLanes minX = FloatLanes::Set1(box.Min.x), minY = FloatLanes::Set1(box.Min.y), minZ = FloatLanes::Set1(box.Min.z);
+            const FloatLanes maxX = FloatLanes::Set1(box.Max.x), maxY = FloatLanes::Set1(box.Max.y), maxZ = FloatLanes::Set1(box.Max.z);
+            ClusterRecord& record = result.Records[tile];
+            record.FirstIndex = (std::uint32_t)result.Indices.size();
+            for (size_t c = 0; c < paddedCount; c += FloatLanes::Count)
+            {
+                // squared distance from the sphere center to the box
+                FloatLanes x = FloatLanes::Load(&result.CandidateX[c]);
+                FloatLanes y = FloatLanes::Load(&result.CandidateY[c]);
+                FloatLanes z = FloatLanes::Load(&result.CandidateZ[c]);
+                FloatLanes dx = FloatLanes::Max(FloatLanes::Max(minX - x, x - maxX), zero);
+                FloatLanes dy = FloatLanes::Max(FloatLanes::Max(minY - y, y - maxY), zero);
+                FloatLanes dz = FloatLanes::Max(FloatLanes::Max(minZ - z, z - maxZ), zero);
+                FloatLanes distanceSquared = dx * dx + dy * dy + dz * dz;
+                int hits = FloatLanes::MoveMask(FloatLanes::LessEqual(distanceSquared, FloatLanes::Load(&result.CandidateRadiusSquared[c])));
+                for (int lane = 0; hits != 0; lane++, hits >>= 1)
+                {
+                    if (hits & 1)
+                        result.Indices.push_back(result.Candidates[c + lane]);
+                }
+            }
+            record.LightCount = (std::uint32_t)result.Indices.size() - record.FirstIndex;
+        }
+    }
+};
+#endif
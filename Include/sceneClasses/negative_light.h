@@ -0,0 +1,54 @@
+#pragma once
+#ifndef NEGATIVE_LIGHT_H
+#define NEGATIVE_LIGHT_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+// Parameters of the "negative light" shading model of mainCubeFragmentShader.glsl:
+// the diffuse and specular terms are subtracted from the ambient term instead of added to it.
+struct NegativeLightProperties
+{
+    glm::vec3 Ambient;
+    glm::vec3 Diffuse;
+    glm::vec3 Specular;
+    glm::vec3 Direction;
+
+    float AttenuationConstantTerm;
+    float AttenuationLinearTerm;
+    float AttenuationQuadraticTerm;
+
+    float Shininess;
+};
+
+// The light of the scene. The coefficients have to be * 1.0 or more in order for the negative light effect to work.
+inline NegativeLightProperties sceneNegativeLight()
+{
+    const glm::vec3 lightColor(1.0f);
+
+    NegativeLightProperties light;
+    light.Ambient = lightColor * 1.0f;
+    light.Diffuse = lightColor * 1.5f;
+    light.Specular = lightColor * 1.0f;
+    light.Direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+    light.AttenuationConstantTerm = 1.0f;
+    light.AttenuationLinearTerm = 0.09f;
+    light.AttenuationQuadraticTerm = 0.032f;
+    light.Shininess = 32.0f;
+    return light;
+}
+
+// Rotation parameters of the light (and of its lamp cube) around the central cube
+const float LIGHT_ORBIT_RADIUS = 3.0f;
+const float LIGHT_ROTATION_SPEED = 1.2f; // Radians per second
+
+inline glm::vec3 orbitingLightPosition(double time)
+{
+    float angle = (float)time * LIGHT_ROTATION_SPEED;
+    return glm::vec3(
+        sin(angle) * LIGHT_ORBIT_RADIUS,
+        sin(angle) * cos(angle) * 2 - 0.5,
+        cos(angle) * LIGHT_ORBIT_RADIUS - 2.0);
+}
+#endif
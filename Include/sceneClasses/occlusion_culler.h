@@ -0,0 +1,138 @@
+#pragma once
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <glm/glm.hpp>
+
+#include <sceneClasses/frustum_culler.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// CPU side of hierarchical-Z occlusion culling. It holds a coarse level of a depth pyramid read back from the GPU
+// (see DepthPyramid): each texel is the farthest window-space depth of the block of pixels it covers, along with the
+// view-projection that frame was drawn with. An object is hidden when the nearest depth its bounding sphere can
+// reach is behind every texel under its screen rectangle: something closer covers that whole rectangle.
+// The depth is a frame or two old, so an object that comes out from behind an occluder appears that much late.
+class OcclusionCuller
+{
+public:
+    OcclusionCuller() : width(0), height(0), fullWidth(0), fullHeight(0), level(0), viewProjection(1.0f), hiddenCount(0) {}
+
+    static bool Enabled()
+    {
+        return enabledSetting();
+    }
+
+    static void SetEnabled(bool enabled)
+    {
+        enabledSetting() = enabled;
+    }
+
+    // `depth`: `levelWidth` x `levelHeight` texels, rows from the bottom, of pyramid level `level` (each texel
+    // covering 2^level pixels on each side of a `framebufferWidth` x `framebufferHeight` depth buffer)
+    void SetDepth(const float* depth, int levelWidth, int levelHeight, int level, int framebufferWidth, int framebufferHeight, const glm::mat4& viewProjection)
+    {
+        this->depth.assign(depth, depth + (size_t)levelWidth * levelHeight);
+        width = levelWidth;
+        height = levelHeight;
+        this->level = level;
+        fullWidth = framebufferWidth;
+        fullHeight = framebufferHeight;
+        this->viewProjection = viewProjection;
+    }
+
+    bool HasDepth() const
+    {
+        return !depth.empty();
+    }
+
+    // removes from `objects` those the depth shows hidden; the spheres come from the FrustumCuller that produced them
+    void Cull(std::vector<std::uint32_t>& objects, const FrustumCuller& spheres)
+    {
+        hiddenCount = 0;
+        if (!HasDepth())
+            return;
+        size_t kept = 0;
+        for (std::uint32_t object : objects)
+        {
+            if (isHidden(spheres.Sphere(object)))
+                hiddenCount++;
+            else
+                objects[kept++] = object;
+        }
+        objects.resize(kept);
+    }
+
+    // objects removed by the last Cull
+    unsigned int HiddenCount() const
+    {
+        return hiddenCount;
+    }
+
+private:
+    std::vector<float> depth;
+    int width, height;
+    int fullWidth, fullHeight;
+    int level;
+    glm::mat4 viewProjection;
+    unsigned int hiddenCount;
+
+    static bool& enabledSetting()
+    {
+        static bool enabled = false;
+        return enabled;
+    }
+
+    bool isHidden(const glm::vec4& sphere) const
+    {
+        // the sphere's world-space bounding box projects onto a rectangle that holds the sphere's, with a nearest
+        // depth no farther than the sphere's
+        glm::vec3 low(0.0f), high(0.0f);
+        for (int corner = 0; corner < 8; corner++)
+        {
+            glm::vec3 offset((corner & 1) ? sphere.w : -sphere.w, (corner & 2) ? sphere.w : -sphere.w, (corner & 4) ? sphere.w : -sphere.w);
+            glm::vec4 clip = viewProjection * glm::vec4(glm::vec3(sphere) + offset, 1.0f);
+            // reaches the near plane: the projection is unbounded
+            if (clip.z < -clip.w || clip.w <= 0.0f)
+                return false;
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            if (corner == 0)
+            {
+                low = ndc;
+                high = ndc;
+            }
+            low = glm::min(low, ndc);
+            high = glm::max(high, ndc);
+        }
+        float nearestDepth = low.z * 0.5f + 0.5f;
+
+        // pixels covered, one more on each side for the rasterization rules, then texels of the level
+        int x0 = texelColumn(low.x, -1), x1 = texelColumn(high.x, 1);
+        int y0 = texelRow(low.y, -1), y1 = texelRow(high.y, 1);
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                if (depth[(size_t)y * width + x] >= nearestDepth)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    int texelColumn(float ndcX, int margin) const
+    {
+        int pixel = (int)std::floor((ndcX * 0.5f + 0.5f) * fullWidth) + margin;
+        return std::min(std::max(pixel, 0) >> level, width - 1);
+    }
+
+    int texelRow(float ndcY, int margin) const
+    {
+        int pixel = (int)std::floor((ndcY * 0.5f + 0.5f) * fullHeight) + margin;
+        return std::min(std::max(pixel, 0) >> level, height - 1);
+    }
+};
+#endif
@@ -0,0 +1,92 @@
+#pragma once
+#ifndef POINT_LIGHT_FIELD_H
+#define POINT_LIGHT_FIELD_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+// A point light of finite range. Negative lights remove their contribution from the lit color
+// instead of adding it, like the orbiting light of the scene.
+struct PointLight
+{
+    glm::vec3 Position; // world space
+    float Radius;       // no contribution beyond this distance
+    glm::vec3 Color;
+    bool Negative;
+};
+
+// Extra point lights scattered over a box (usually the bounds of the CubeField), each bobbing on a small
+// circle around its anchor. Three lights out of four are negative. The layout is deterministic, so every
+// benchmark run sees the same lights.
+class PointLightField
+{
+public:
+    std::vector<PointLight> Lights;
+
+    PointLightField(unsigned int count, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+    {
+        anchors.reserve(count);
+        motions.reserve(count);
+        Lights.reserve(count);
+        for (unsigned int i = 0; i < count; i++)
+        {
+            glm::vec3 t(hashToUnitFloat(i * 8u), hashToUnitFloat(i * 8u + 1u), hashToUnitFloat(i * 8u + 2u));
+            anchors.push_back(boundsMin + (boundsMax - boundsMin) * t);
+
+            Motion motion;
+            motion.OrbitRadius = 0.5f + 1.5f * hashToUnitFloat(i * 8u + 3u);
+            motion.Speed = 0.5f + hashToUnitFloat(i * 8u + 4u);
+            motion.Phase = 6.2831853f * hashToUnitFloat(i * 8u + 5u);
+            motions.push_back(motion);
+
+            PointLight light;
+            light.Position = anchors.back();
+            light.Radius = 2.5f + 2.5f * hashToUnitFloat(i * 8u + 6u);
+            float hue = hashToUnitFloat(i * 8u + 7u);
+            light.Color = glm::vec3(0.6f + 0.6f * hue, 1.0f, 1.2f - 0.6f * hue);
+            light.Negative = (i % 4) != 3;
+            Lights.push_back(light);
+        }
+    }
+
+    unsigned int Count() const
+    {
+        return (unsigned int)Lights.size();
+    }
+
+    // moves every light to its position at the given time (in seconds)
+    void Update(double time)
+    {
+        for (size_t i = 0; i < Lights.size(); i++)
+        {
+            const Motion& motion = motions[i];
+            float angle = (float)time * motion.Speed + motion.Phase;
+            Lights[i].Position = anchors[i] + motion.OrbitRadius * glm::vec3(std::sin(angle), 0.5f * std::sin(2.0f * angle), std::cos(angle));
+        }
+    }
+
+private:
+    struct Motion
+    {
+        float OrbitRadius;
+        float Speed;  // Radians per second
+        float Phase;
+    };
+    std::vector<glm::vec3> anchors;
+    std::vector<Motion> motions;
+
+    // same integer hash as the CubeField jitter, mapped to [0, 1)
+    static float hashToUnitFloat(std::uint32_t value)
+    {
+        value ^= value >> 16;
+        value *= 0x7feb352dU;
+        value ^= value >> 15;
+        value *= 0x846ca68bU;
+        value ^= value >> 16;
+        return (value >> 8) * (1.0f / 16777216.0f);
+    }
+};
+#endif
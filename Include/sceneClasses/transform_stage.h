@@ -0,0 +1,126 @@
+#pragma once
+#ifndef TRANSFORM_STAGE_H
+#define TRANSFORM_STAGE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <sceneClasses/cube_field.h>
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+// Per-object view-space transforms, laid out exactly as they are streamed to the GPU.
+// The normal matrix is stored as three 16-byte columns so each one is a single vector store; the shader only reads .xyz of each.
+struct alignas(16) ViewSpaceTransform
+{
+    float ModelViewMatrix[16];
+    float NormalMatrix[12];
+};
+
+// Batched CPU transform stage: once per frame, computes for every object
+//   modelView = view * model
+//   normal    = mat3(view) * transpose(inverse(mat3(model)))
+// so that no vertex shader has to invert a matrix per vertex. The view matrix is a rigid transform,
+// hence the view-space normal matrix only needs the world-space one, which is computed once in SetObjects.
+// With GLM_FORCE_INTRINSICS on an SSE2 target both products go through glm's SIMD matrix multiply.
+class TransformStage
+{
+public:
+    std::vector<ViewSpaceTransform> Output;
+
+    void SetObjects(const std::vector<CubeInstance>& instances)
+    {
+        worldTransforms.resize(instances.size());
+        Output.resize(instances.size());
+        outputCount = instances.size();
+        for (size_t i = 0; i < instances.size(); i++)
+        {
+            // the normal matrix is padded to a 4x4 with a zero translation so it can share the mat4 multiply
+            glm::mat4 paddedNormalMatrix = glm::mat4(instances[i].NormalMatrix);
+            paddedNormalMatrix[3] = glm::vec4(0.0f);
+            std::memcpy(worldTransforms[i].ModelMatrix, glm::value_ptr(instances[i].ModelMatrix), sizeof(worldTransforms[i].ModelMatrix));
+            std::memcpy(worldTransforms[i].NormalMatrix, glm::value_ptr(paddedNormalMatrix), sizeof(worldTransforms[i].NormalMatrix));
+        }
+    }
+
+    void Update(const glm::mat4& viewMatrix)
+    {
+        update(viewMatrix, NULL, worldTransforms.size());
+    }
+
+    // only the listed objects (such as those a FrustumCuller kept): Output[i] is the transform of objects[i]
+    void Update(const glm::mat4& viewMatrix, const std::vector<std::uint32_t>& objects)
+    {
+        update(viewMatrix, objects.data(), objects.size());
+    }
+
+    // transforms written by the last Update
+    unsigned int Count() const
+    {
+        return (unsigned int)outputCount;
+    }
+
+private:
+    struct alignas(16) WorldTransform
+    {
+        float ModelMatrix[16];
+        float NormalMatrix[16];
+    };
+
+    // objects == NULL: every object, in order. The loads and stores are unaligned ones: std::allocator only honors
+    // alignas(16) from C++17, and 32-bit malloc only guarantees 8 bytes (they cost the same on aligned data anyway)
+    void update(const glm::mat4& viewMatrix, const std::uint32_t* objects, size_t count)
+    {
+        outputCount = count;
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+        glm_vec4 view[4];
+        for (int column = 0; column < 4; column++)
+            view[column] = _mm_loadu_ps(&viewMatrix[column][0]);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const WorldTransform& world = worldTransforms[objects ? objects[i] : i];
+            ViewSpaceTransform& result = Output[i];
+
+            glm_vec4 model[4], normal[4], product[4];
+            for (int column = 0; column < 4; column++)
+            {
+                model[column] = _mm_loadu_ps(world.ModelMatrix + column * 4);
+                normal[column] = _mm_loadu_ps(world.NormalMatrix + column * 4);
+            }
+
+            glm_mat4_mul(view, model, product);
+            for (int column = 0; column < 4; column++)
+                _mm_storeu_ps(result.ModelViewMatrix + column * 4, product[column]);
+
+            glm_mat4_mul(view, normal, product);
+            for (int column = 0; column < 3; column++)
+                _mm_storeu_ps(result.NormalMatrix + column * 4, product[column]);
+        }
+#else
+        const glm::mat3 viewRotation = glm::mat3(viewMatrix);
+        for (size_t i = 0; i < count; i++)
+        {
+            const WorldTransform& world = worldTransforms[objects ? objects[i] : i];
+            ViewSpaceTransform& result = Output[i];
+
+            glm::mat4 modelView = viewMatrix * glm::make_mat4(world.ModelMatrix);
+            glm::mat3 normal = viewRotation * glm::mat3(glm::make_mat4(world.NormalMatrix));
+            std::memcpy(result.ModelViewMatrix, glm::value_ptr(modelView), sizeof(result.ModelViewMatrix));
+            for (int column = 0; column < 3; column++)
+            {
+                result.NormalMatrix[column * 4 + 0] = normal[column][0];
+                result.NormalMatrix[column * 4 + 1] = normal[column][1];
+                result.NormalMatrix[column * 4 + 2] = normal[column][2];
+                result.NormalMatrix[column * 4 + 3] = 0.0f;
+            }
+        }
+#endif
+    }
+
+    std::vector<WorldTransform> worldTransforms;
+    size_t outputCount = 0;
+};
+#endif
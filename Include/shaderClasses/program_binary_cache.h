@@ -0,0 +1,152 @@
+#pragma once
+#ifndef PROGRAM_BINARY_CACHE_H
+#define PROGRAM_BINARY_CACHE_H
+
+#include <glad/glad.h>
+
+#include <fileClasses/file_system.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// On-disk cache of linked program binaries (glGetProgramBinary / glProgramBinary, core since GL 4.1).
+// A program is stored under a 64-bit key hashed from its GLSL sources and from the GL vendor, renderer
+// and version strings, so editing a shader or updating the driver simply misses the cache. A cached
+// binary the driver refuses anyway is deleted, and the caller compiles from source.
+class ProgramBinaryCache
+{
+public:
+    // the cache is on unless disabled (--no-shader-cache) and the driver offers at least one binary format
+    static bool Enabled()
+    {
+        if (!enabledSetting())
+            return false;
+        if (!GLAD_GL_VERSION_4_1 || glProgramBinary == NULL || glGetProgramBinary == NULL)
+            return false;
+        int formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        return formatCount > 0;
+    }
+
+    static void SetEnabled(bool enabled)
+    {
+        enabledSetting() = enabled;
+    }
+
+    static std::uint64_t Key(const std::vector<std::string>& sources)
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+        auto hashBytes = [&hash](const char* bytes, size_t length) {
+            for (size_t i = 0; i < length; i++)
+                hash = (hash ^ static_cast<std::uint8_t>(bytes[i])) * 1099511628211ull;
+            // separator, so that moving text from one string to the next changes the key
+            hash = (hash ^ 0xffu) * 1099511628211ull;
+        };
+        const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        for (GLenum name : driverStrings)
+        {
+            const char* value = reinterpret_cast<const char*>(glGetString(name));
+            std::string text = value ? value : "";
+            hashBytes(text.data(), text.size());
+        }
+        for (const std::string& source : sources)
+            hashBytes(source.data(), source.size());
+        return hash;
+    }
+
+    // restores a program from the cache; false (and the program left unlinked) on a miss or a rejected binary
+    static bool Load(std::uint64_t key, unsigned int program)
+    {
+        std::string path = pathFor(key);
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+
+        FileHeader header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        std::vector<char> binary;
+        if (file && header.Magic == MAGIC && header.FormatVersion == FORMAT_VERSION && header.Key == key)
+        {
+            binary.resize(header.Length);
+            file.read(binary.data(), binary.size());
+        }
+        file.close();
+        if (binary.empty() || binary.size() != header.Length)
+        {
+            std::remove(path.c_str());
+            return false;
+        }
+
+        glProgramBinary(program, header.BinaryFormat, binary.data(), (GLsizei)binary.size());
+        int linked = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
+            // stale binary (driver updated under the same version string, or corrupt file): drop it
+            std::remove(path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // stores a successfully linked program; linking it with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set lets the driver keep the binary around
+    static void Store(std::uint64_t key, unsigned int program)
+    {
+        int linked = 0, length = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (!linked || length <= 0)
+            return;
+
+        std::vector<char> binary(length);
+        GLenum binaryFormat = 0;
+        glGetProgramBinary(program, length, &length, &binaryFormat, binary.data());
+
+        makeDirectory(directory());
+        std::ofstream file(pathFor(key), std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR::PROGRAM_BINARY_CACHE::CANNOT_WRITE: " << pathFor(key) << std::endl;
+            return;
+        }
+        FileHeader header = { MAGIC, FORMAT_VERSION, key, binaryFormat, (std::uint32_t)length };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), length);
+    }
+
+private:
+    static const std::uint32_t MAGIC = 0x4250504eu; // "NPPB"
+    static const std::uint32_t FORMAT_VERSION = 1;
+
+    struct FileHeader
+    {
+        std::uint32_t Magic;
+        std::uint32_t FormatVersion;
+        std::uint64_t Key;
+        std::uint32_t BinaryFormat;
+        std::uint32_t Length;
+    };
+
+    static bool& enabledSetting()
+    {
+        static bool enabled = true;
+        return enabled;
+    }
+
+    static const char* directory()
+    {
+        return "shader_cache";
+    }
+
+    static std::string pathFor(std::uint64_t key)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+        return std::string(directory()) + "/" + name;
+    }
+};
+#endif
@@ -0,0 +1,115 @@
+#pragma once
+#ifndef SHADER_MANAGER_H
+#define SHADER_MANAGER_H
+
+#include <glad/glad.h>
+
+#include <shaderClasses/shader_s.h>
+#include <renderClasses/gl_extensions.h>
+
+#include <memory>
+#include <vector>
+
+// GL_KHR_parallel_shader_compile (and its ARB twin) are not in the generated glad loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Builds every program of the application at once: Submit() hands the compile and link of a program to the
+// driver and returns immediately, Get() waits for that program the first time it is needed. With
+// GL_KHR_parallel_shader_compile the driver compiles the submitted programs concurrently on its own threads
+// while the application keeps loading, and IsReady() tells without blocking whether Get() would wait.
+class ShaderManager
+{
+public:
+    typedef size_t Handle;
+
+    // loadProc (e.g. glfwGetProcAddress) resolves the extension entry point that sets the driver's thread count
+    explicit ShaderManager(GLADloadproc loadProc = NULL) : parallelCompile(false)
+    {
+        parallelCompile = hasGLExtension("GL_KHR_parallel_shader_compile") || hasGLExtension("GL_ARB_parallel_shader_compile");
+        if (parallelCompile && loadProc != NULL)
+        {
+            typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+            MaxShaderCompilerThreadsProc maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)loadProc("glMaxShaderCompilerThreadsKHR");
+            if (maxShaderCompilerThreads == NULL)
+                maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)loadProc("glMaxShaderCompilerThreadsARB");
+            // 0xFFFFFFFF: as many threads as the driver sees fit
+            if (maxShaderCompilerThreads != NULL)
+                maxShaderCompilerThreads(0xFFFFFFFFu);
+        }
+    }
+
+    ShaderManager(const ShaderManager&) = delete;
+    ShaderManager& operator=(const ShaderManager&) = delete;
+
+    Handle Submit(const char* vertexPath, const char* fragmentPath)
+    {
+        programs.emplace_back(new Shader(vertexPath, fragmentPath, Shader::DeferredBuild()));
+        return programs.size() - 1;
+    }
+
+    // a compute program; the context must be OpenGL 4.3 or later
+    Handle SubmitCompute(const char* computePath)
+    {
+        programs.emplace_back(new Shader(computePath, Shader::ComputeStage(), Shader::DeferredBuild()));
+        return programs.size() - 1;
+    }
+
+    // whether Get() would return without waiting for the driver; without the extension there is no way
+    // to ask, and programs only count as ready once built
+    bool IsReady(Handle handle) const
+    {
+        const Shader& shader = *programs[handle];
+        if (shader.isBuilt() || shader.LoadedFromCache)
+            return true;
+        if (!parallelCompile)
+            return false;
+        int completed = 0;
+        glGetProgramiv(shader.ID, GL_COMPLETION_STATUS_KHR, &completed);
+        return completed != 0;
+    }
+
+    // the program, built: blocks until the driver is done with it the first time
+    Shader& Get(Handle handle)
+    {
+        Shader& shader = *programs[handle];
+        shader.finishBuild();
+        return shader;
+    }
+
+    void FinishAll()
+    {
+        for (std::unique_ptr<Shader>& shader : programs)
+            shader->finishBuild();
+    }
+
+    // releases every program; call while the context is still current
+    void Clear()
+    {
+        programs.clear();
+    }
+
+    bool ParallelCompile() const
+    {
+        return parallelCompile;
+    }
+
+    size_t Count() const
+    {
+        return programs.size();
+    }
+
+    size_t CachedCount() const
+    {
+        size_t count = 0;
+        for (const std::unique_ptr<Shader>& shader : programs)
+            count += shader->LoadedFromCache ? 1 : 0;
+        return count;
+    }
+
+private:
+    std::vector<std::unique_ptr<Shader>> programs;
+    bool parallelCompile;
+};
+#endif
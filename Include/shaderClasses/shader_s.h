@@ -3,19 +3,54 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <shaderClasses/program_binary_cache.h>
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+// 32-bit FNV-1a hash of a uniform name, usable in constant expressions
+constexpr std::uint32_t hashUniformName(const char* name, std::uint32_t hash = 2166136261u)
+{
+    return *name ? hashUniformName(name + 1, (hash ^ static_cast<std::uint8_t>(*name)) * 16777619u) : hash;
+}
+
+// A uniform name with its hash. Declare handles constexpr so the hashing happens at compile time
+// and the setters below never build a std::string nor ask the driver for a location.
+struct UniformHandle
+{
+    std::uint32_t hash;
+    const char* name;
+
+    constexpr explicit UniformHandle(const char* uniformName) : hash(hashUniformName(uniformName)), name(uniformName) {}
+};
 
 class Shader
 {
 public:
     unsigned int ID;
+    // true when the program was restored from the ProgramBinaryCache instead of compiled
+    bool LoadedFromCache;
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath)
+    Shader(const char* vertexPath, const char* fragmentPath) : Shader(vertexPath, fragmentPath, DeferredBuild())
+    {
+        finishBuild();
+    }
+
+    // tag for the constructor below
+    struct DeferredBuild {};
+    // submits the compile and link to the driver without waiting for them: nothing queries the results
+    // until finishBuild(), so drivers compiling in the background (GL_KHR_parallel_shader_compile) can
+    // work on several programs at once. See ShaderManager.
+    // ------------------------------------------------------------------------
+    Shader(const char* vertexPath, const char* fragmentPath, DeferredBuild) : LoadedFromCache(false), built(false), useCache(false), cacheKey(0)
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
@@ -45,34 +80,69 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        glDetachShader(ID, vertex);
-        glDetachShader(ID, fragment);
+        submit({ { GL_VERTEX_SHADER, "VERTEX", vertexCode }, { GL_FRAGMENT_SHADER, "FRAGMENT", fragmentCode } });
+    }
+
+    // tag for the constructor below
+    struct ComputeStage {};
+    // a compute program (OpenGL 4.3), submitted without waiting like the one above
+    // ------------------------------------------------------------------------
+    Shader(const char* computePath, ComputeStage, DeferredBuild) : LoadedFromCache(false), built(false), useCache(false), cacheKey(0)
+    {
+        std::string computeCode;
+        std::ifstream cShaderFile;
+        cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            cShaderFile.open(computePath);
+            std::stringstream cShaderStream;
+            cShaderStream << cShaderFile.rdbuf();
+            cShaderFile.close();
+            computeCode = cShaderStream.str();
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+        }
+        submit({ { GL_COMPUTE_SHADER, "COMPUTE", computeCode } });
+    }
+
+    // waits for the compile and link submitted by the constructor, reports errors and reflects the uniforms;
+    // does nothing the second time
+    // ------------------------------------------------------------------------
+    void finishBuild()
+    {
+        if (built)
+            return;
+        built = true;
+        if (!LoadedFromCache)
+        {
+            for (const CompiledStage& stage : stages)
+                checkCompileErrors(stage.Object, stage.Type);
+            checkCompileErrors(ID, "PROGRAM");
 
-        // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+            // delete the shaders as they're linked into our program now and no longer necessary
+            for (const CompiledStage& stage : stages)
+            {
+                glDetachShader(ID, stage.Object);
+                glDeleteShader(stage.Object);
+            }
+            stages.clear();
+
+            if (useCache)
+                ProgramBinaryCache::Store(cacheKey, ID);
+        }
+        reflectUniforms();
     }
 
+    bool isBuilt() const
+    {
+        return built;
+    }
+
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
     // destructor
     ~ Shader() {
         glDeleteProgram(ID);
@@ -84,66 +154,197 @@ public:
         glUseProgram(ID);
     }
 
-    // utility uniform functions
+    // returns the location of an active uniform from the table built at link time, -1 if the program has none by that name.
+    // The hash finds the slot, the name confirms it: two names sharing a hash both keep their own location
     // ------------------------------------------------------------------------
-    void setBool(const std::string& name, bool value) const
+    int location(UniformHandle uniform) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        auto it = std::lower_bound(uniformTable.begin(), uniformTable.end(), uniform.hash,
+            [](const UniformSlot& slot, std::uint32_t value) { return slot.hash < value; });
+        for (; it != uniformTable.end() && it->hash == uniform.hash; ++it)
+        {
+            if (it->name == uniform.name)
+                return it->location;
+        }
+        return -1;
+    }
+
+    // attaches a uniform block of the program to a binding point; blocks the program does not use are ignored
+    // ------------------------------------------------------------------------
+    void bindUniformBlock(const char* blockName, unsigned int binding) const
+    {
+        unsigned int blockIndex = glGetUniformBlockIndex(ID, blockName);
+        if (blockIndex != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, blockIndex, binding);
     }
+
+    // utility uniform functions (hot path: pass constexpr UniformHandles)
     // ------------------------------------------------------------------------
-    void setInt(const std::string& name, int value) const
+    void setBool(UniformHandle uniform, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(location(uniform), (int)value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string& name, float value) const
+    void setInt(UniformHandle uniform, int value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(location(uniform), value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string& name, const glm::vec2& value) const
+    void setFloat(UniformHandle uniform, float value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform1f(location(uniform), value);
     }
-    void setVec2(const std::string& name, float x, float y) const
+    // ------------------------------------------------------------------------
+    void setVec2(UniformHandle uniform, const glm::vec2& value) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2fv(location(uniform), 1, &value[0]);
+    }
+    void setVec2(UniformHandle uniform, float x, float y) const
+    {
+        glUniform2f(location(uniform), x, y);
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string& name, const glm::vec3& value) const
+    void setVec3(UniformHandle uniform, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(location(uniform), 1, &value[0]);
     }
-    void setVec3(const std::string& name, float x, float y, float z) const
+    void setVec3(UniformHandle uniform, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(location(uniform), x, y, z);
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string& name, const glm::vec4& value) const
+    void setVec4(UniformHandle uniform, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(location(uniform), 1, &value[0]);
     }
-    void setVec4(const std::string& name, float x, float y, float z, float w) const
+    void setVec4(UniformHandle uniform, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(location(uniform), x, y, z, w);
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string& name, const glm::mat2& mat) const
+    void setMat2(UniformHandle uniform, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(location(uniform), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string& name, const glm::mat3& mat) const
+    void setMat3(UniformHandle uniform, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(location(uniform), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string& name, const glm::mat4& mat) const
+    void setMat4(UniformHandle uniform, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(location(uniform), 1, GL_FALSE, &mat[0][0]);
     }
 
+    // string overloads, kept for one-off setup code: hashed at runtime, still no driver lookup
+    // ------------------------------------------------------------------------
+    void setBool(const std::string& name, bool value) const { setBool(UniformHandle(name.c_str()), value); }
+    void setInt(const std::string& name, int value) const { setInt(UniformHandle(name.c_str()), value); }
+    void setFloat(const std::string& name, float value) const { setFloat(UniformHandle(name.c_str()), value); }
+    void setVec2(const std::string& name, const glm::vec2& value) const { setVec2(UniformHandle(name.c_str()), value); }
+    void setVec2(const std::string& name, float x, float y) const { setVec2(UniformHandle(name.c_str()), x, y); }
+    void setVec3(const std::string& name, const glm::vec3& value) const { setVec3(UniformHandle(name.c_str()), value); }
+    void setVec3(const std::string& name, float x, float y, float z) const { setVec3(UniformHandle(name.c_str()), x, y, z); }
+    void setVec4(const std::string& name, const glm::vec4& value) const { setVec4(UniformHandle(name.c_str()), value); }
+    void setVec4(const std::string& name, float x, float y, float z, float w) const { setVec4(UniformHandle(name.c_str()), x, y, z, w); }
+    void setMat2(const std::string& name, const glm::mat2& mat) const { setMat2(UniformHandle(name.c_str()), mat); }
+    void setMat3(const std::string& name, const glm::mat3& mat) const { setMat3(UniformHandle(name.c_str()), mat); }
+    void setMat4(const std::string& name, const glm::mat4& mat) const { setMat4(UniformHandle(name.c_str()), mat); }
+
 private:
+    struct StageSource
+    {
+        GLenum Stage;
+        const char* Type; // for error messages
+        std::string Code;
+    };
+    struct CompiledStage
+    {
+        unsigned int Object;
+        const char* Type;
+    };
+
+    // build state between the constructor and finishBuild()
+    bool built;
+    std::vector<CompiledStage> stages;
+    bool useCache;
+    std::uint64_t cacheKey;
+
+    // hands the compile and link of the stages to the driver
+    // ------------------------------------------------------------------------
+    void submit(const std::vector<StageSource>& sources)
+    {
+        // 2. reuse the program linked by a previous run when the sources and the driver are unchanged
+        ID = glCreateProgram();
+        useCache = ProgramBinaryCache::Enabled();
+        std::vector<std::string> codes;
+        for (const StageSource& source : sources)
+            codes.push_back(source.Code);
+        cacheKey = useCache ? ProgramBinaryCache::Key(codes) : 0;
+        if (useCache && ProgramBinaryCache::Load(cacheKey, ID))
+        {
+            LoadedFromCache = true;
+            return;
+        }
+        // 3. compile shaders and link them into the program
+        for (const StageSource& source : sources)
+        {
+            const char* code = source.Code.c_str();
+            unsigned int shader = glCreateShader(source.Stage);
+            glShaderSource(shader, 1, &code, NULL);
+            glCompileShader(shader);
+            glAttachShader(ID, shader);
+            stages.push_back({ shader, source.Type });
+        }
+        if (useCache)
+            glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(ID);
+    }
+
+    struct UniformSlot
+    {
+        std::uint32_t hash;
+        int location;
+        std::string name;
+    };
+    // active uniforms of the linked program, sorted by name hash
+    std::vector<UniformSlot> uniformTable;
+
+    // queries every active uniform once after linking and stores its location in the flat table
+    // ------------------------------------------------------------------------
+    void reflectUniforms()
+    {
+        uniformTable.clear();
+        int uniformCount = 0, maxNameLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+        std::vector<char> nameBuffer(maxNameLength > 0 ? maxNameLength : 1);
+
+        for (int i = 0; i < uniformCount; i++)
+        {
+            int nameLength = 0, size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)nameBuffer.size(), &nameLength, &size, &type, nameBuffer.data());
+            std::string name(nameBuffer.data(), nameLength);
+            int uniformLocation = glGetUniformLocation(ID, name.c_str());
+            // uniforms living in a block have no location
+            if (uniformLocation < 0)
+                continue;
+            addUniformSlot(name, uniformLocation);
+            // arrays are reported as "name[0]"; also register the bare name
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+                addUniformSlot(name.substr(0, name.size() - 3), uniformLocation);
+        }
+        std::sort(uniformTable.begin(), uniformTable.end(),
+            [](const UniformSlot& a, const UniformSlot& b) { return a.hash < b.hash; });
+    }
+
+    void addUniformSlot(const std::string& name, int uniformLocation)
+    {
+        uniformTable.push_back({ hashUniformName(name.c_str()), uniformLocation, name });
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(unsigned int shader, std::string type)
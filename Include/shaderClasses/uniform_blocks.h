@@ -0,0 +1,104 @@
+#pragma once
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+
+#include <glm/glm.hpp>
+
+#include <sceneClasses/negative_light.h>
+
+#include <cstddef>
+#include <cstring>
+
+// CPU mirrors of the std140 uniform blocks declared in the shaders. The padding members make the
+// C++ layout match std140, and the static_asserts below check the offsets the GLSL compiler uses.
+
+// Binding points, shared by every program declaring the block
+enum UniformBlockBinding {
+    FRAME_UNIFORMS_BINDING = 0,
+    LIGHTING_UNIFORMS_BINDING = 1,
+    CLUSTER_UNIFORMS_BINDING = 2
+};
+
+// layout (std140) uniform FrameUniforms: camera and light position, changes every frame the camera or the light moves
+struct FrameUniforms
+{
+    glm::mat4 ProjectionMatrix;
+    glm::mat4 ViewMatrix;
+    glm::vec3 ViewPosition;
+    float Padding0;
+    glm::vec3 LightPosition; // world space
+    float Padding1;
+};
+
+// layout (std140) uniform LightingUniforms: the light properties and the material shininess, constant in this scene
+struct LightingUniforms
+{
+    // struct LightProperties lightProperties (a struct is aligned, and padded, to 16 bytes)
+    glm::vec3 Direction;
+    float Padding0;
+    glm::vec3 Ambient;
+    float Padding1;
+    glm::vec3 Diffuse;
+    float Padding2;
+    glm::vec3 Specular;
+    float AttenuationConstantTerm;
+    float AttenuationLinearTerm;
+    float AttenuationQuadraticTerm;
+    float Padding3[2];
+    // float materialShininess
+    float MaterialShininess;
+    float Padding4[3];
+};
+
+// layout (std140) uniform ClusterUniforms: shape of the LightClusterGrid, changes with the projection only
+struct ClusterUniforms
+{
+    glm::uvec4 GridSize;  // froxel counts, number of point lights
+    glm::vec4 Parameters; // slice = log(depth) * x + y, screen tile size in pixels
+};
+
+static_assert(offsetof(FrameUniforms, ViewMatrix) == 64, "FrameUniforms does not match std140");
+static_assert(offsetof(FrameUniforms, ViewPosition) == 128, "FrameUniforms does not match std140");
+static_assert(offsetof(FrameUniforms, LightPosition) == 144, "FrameUniforms does not match std140");
+static_assert(sizeof(FrameUniforms) == 160, "FrameUniforms does not match std140");
+static_assert(offsetof(LightingUniforms, Specular) == 48, "LightingUniforms does not match std140");
+static_assert(offsetof(LightingUniforms, AttenuationConstantTerm) == 60, "LightingUniforms does not match std140");
+static_assert(offsetof(LightingUniforms, MaterialShininess) == 80, "LightingUniforms does not match std140");
+static_assert(sizeof(LightingUniforms) == 96, "LightingUniforms does not match std140");
+static_assert(sizeof(ClusterUniforms) == 32, "ClusterUniforms does not match std140");
+
+inline FrameUniforms makeFrameUniforms(const glm::mat4& projectionMatrix, const glm::mat4& viewMatrix, const glm::vec3& viewPosition, const glm::vec3& lightPosition)
+{
+    FrameUniforms block;
+    // zeroed so that the padding compares equal between frames
+    std::memset(&block, 0, sizeof(block));
+    block.ProjectionMatrix = projectionMatrix;
+    block.ViewMatrix = viewMatrix;
+    block.ViewPosition = viewPosition;
+    block.LightPosition = lightPosition;
+    return block;
+}
+
+inline LightingUniforms makeLightingUniforms(const NegativeLightProperties& light)
+{
+    LightingUniforms block;
+    std::memset(&block, 0, sizeof(block));
+    block.Direction = light.Direction;
+    block.Ambient = light.Ambient;
+    block.Diffuse = light.Diffuse;
+    block.Specular = light.Specular;
+    block.AttenuationConstantTerm = light.AttenuationConstantTerm;
+    block.AttenuationLinearTerm = light.AttenuationLinearTerm;
+    block.AttenuationQuadraticTerm = light.AttenuationQuadraticTerm;
+    block.MaterialShininess = light.Shininess;
+    return block;
+}
+
+inline ClusterUniforms makeClusterUniforms(const glm::uvec3& gridSize, unsigned int lightCount, const glm::vec2& sliceParameters, const glm::vec2& tileSize)
+{
+    ClusterUniforms block;
+    block.GridSize = glm::uvec4(gridSize, lightCount);
+    block.Parameters = glm::vec4(sliceParameters, tileSize);
+    return block;
+}
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// A uniform buffer holding one std140 block of type Block, bound once to a binding point shared by every program
+// that declares the block (see Shader::bindUniformBlock). Update() keeps a CPU copy of the last upload and only
+// calls glBufferSubData when the contents actually changed, so static blocks cost nothing per frame.
+// Block must be laid out by hand to match std140 (vec3 and structs aligned on 16 bytes).
+template <typename Block>
+class UniformBuffer
+{
+public:
+    unsigned int ID;
+
+    explicit UniformBuffer(unsigned int binding) : Binding(binding), uploadCount(0), hasContents(false)
+    {
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, ID);
+    }
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    ~UniformBuffer()
+    {
+        glDeleteBuffers(1, &ID);
+    }
+
+    // uploads the block if it differs from the previous upload; returns whether an upload happened
+    bool Update(const Block& contents)
+    {
+        if (hasContents && std::memcmp(&contents, &lastContents, sizeof(Block)) == 0)
+            return false;
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &contents);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        std::memcpy(&lastContents, &contents, sizeof(Block));
+        hasContents = true;
+        uploadCount++;
+        return true;
+    }
+
+    // number of glBufferSubData calls so far
+    unsigned long long UploadCount() const
+    {
+        return uploadCount;
+    }
+
+    const unsigned int Binding;
+
+private:
+    Block lastContents;
+    unsigned long long uploadCount;
+    bool hasContents;
+};
+#endif
@@ -0,0 +1,145 @@
+#pragma once
+#ifndef FLOAT_LANES_H
+#define FLOAT_LANES_H
+
+// A pack of floats processed together: 8 lanes with AVX2, 4 with SSE2, 1 otherwise.
+// Comparisons return masks of the same type (all bits set in the lanes where the comparison holds).
+// Min and Max return `b` in the lanes where `a` is NaN, as the SSE instructions do.
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FLOAT_LANES_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FLOAT_LANES_SSE2 1
+#endif
+
+#include <cmath>
+
+struct FloatLanes
+{
+#if defined(FLOAT_LANES_AVX2)
+    static const int Count = 8;
+    __m256 v;
+
+    FloatLanes() {}
+    FloatLanes(__m256 value) : v(value) {}
+
+    static FloatLanes Set1(float value) { return _mm256_set1_ps(value); }
+    static FloatLanes Load(const float* values) { return _mm256_loadu_ps(values); }
+    // 0, 1, 2, ... Count - 1
+    static FloatLanes Ramp() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+    void Store(float* values) const { _mm256_storeu_ps(values, v); }
+
+    friend FloatLanes operator+(FloatLanes a, FloatLanes b) { return _mm256_add_ps(a.v, b.v); }
+    friend FloatLanes operator-(FloatLanes a, FloatLanes b) { return _mm256_sub_ps(a.v, b.v); }
+    friend FloatLanes operator*(FloatLanes a, FloatLanes b) { return _mm256_mul_ps(a.v, b.v); }
+    friend FloatLanes operator/(FloatLanes a, FloatLanes b) { return _mm256_div_ps(a.v, b.v); }
+
+    static FloatLanes Min(FloatLanes a, FloatLanes b) { return _mm256_min_ps(a.v, b.v); }
+    static FloatLanes Max(FloatLanes a, FloatLanes b) { return _mm256_max_ps(a.v, b.v); }
+    static FloatLanes Sqrt(FloatLanes a) { return _mm256_sqrt_ps(a.v); }
+    static FloatLanes Floor(FloatLanes a) { return _mm256_floor_ps(a.v); }
+
+    static FloatLanes Less(FloatLanes a, FloatLanes b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+    static FloatLanes LessEqual(FloatLanes a, FloatLanes b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+    static FloatLanes Greater(FloatLanes a, FloatLanes b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+    static FloatLanes GreaterEqual(FloatLanes a, FloatLanes b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+    static FloatLanes And(FloatLanes a, FloatLanes b) { return _mm256_and_ps(a.v, b.v); }
+    // mask ? a : b, lane by lane
+    static FloatLanes Select(FloatLanes mask, FloatLanes a, FloatLanes b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+    // one bit per lane, lane 0 in bit 0
+    static int MoveMask(FloatLanes mask) { return _mm256_movemask_ps(mask.v); }
+#elif defined(FLOAT_LANES_SSE2)
+    static const int Count = 4;
+    __m128 v;
+
+    FloatLanes() {}
+    FloatLanes(__m128 value) : v(value) {}
+
+    static FloatLanes Set1(float value) { return _mm_set1_ps(value); }
+    static FloatLanes Load(const float* values) { return _mm_loadu_ps(values); }
+    static FloatLanes Ramp() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+    void Store(float* values) const { _mm_storeu_ps(values, v); }
+
+    friend FloatLanes operator+(FloatLanes a, FloatLanes b) { return _mm_add_ps(a.v, b.v); }
+    friend FloatLanes operator-(FloatLanes a, FloatLanes b) { return _mm_sub_ps(a.v, b.v); }
+    friend FloatLanes operator*(FloatLanes a, FloatLanes b) { return _mm_mul_ps(a.v, b.v); }
+    friend FloatLanes operator/(FloatLanes a, FloatLanes b) { return _mm_div_ps(a.v, b.v); }
+
+    static FloatLanes Min(FloatLanes a, FloatLanes b) { return _mm_min_ps(a.v, b.v); }
+    static FloatLanes Max(FloatLanes a, FloatLanes b) { return _mm_max_ps(a.v, b.v); }
+    static FloatLanes Sqrt(FloatLanes a) { return _mm_sqrt_ps(a.v); }
+    static FloatLanes Floor(FloatLanes a)
+    {
+        // SSE2 has no floor: truncate, then step down where truncation rounded up
+        __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+        return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, a.v), _mm_set1_ps(1.0f)));
+    }
+
+    static FloatLanes Less(FloatLanes a, FloatLanes b) { return _mm_cmplt_ps(a.v, b.v); }
+    static FloatLanes LessEqual(FloatLanes a, FloatLanes b) { return _mm_cmple_ps(a.v, b.v); }
+    static FloatLanes Greater(FloatLanes a, FloatLanes b) { return _mm_cmpgt_ps(a.v, b.v); }
+    static FloatLanes GreaterEqual(FloatLanes a, FloatLanes b) { return _mm_cmpge_ps(a.v, b.v); }
+    static FloatLanes And(FloatLanes a, FloatLanes b) { return _mm_and_ps(a.v, b.v); }
+    static FloatLanes Select(FloatLanes mask, FloatLanes a, FloatLanes b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+    static int MoveMask(FloatLanes mask) { return _mm_movemask_ps(mask.v); }
+#else
+    static const int Count = 1;
+    float v;
+
+    FloatLanes() {}
+    FloatLanes(float value) : v(value) {}
+
+    static FloatLanes Set1(float value) { return value; }
+    static FloatLanes Load(const float* values) { return values[0]; }
+    static FloatLanes Ramp() { return 0.0f; }
+    void Store(float* values) const { values[0] = v; }
+
+    friend FloatLanes operator+(FloatLanes a, FloatLanes b) { return a.v + b.v; }
+    friend FloatLanes operator-(FloatLanes a, FloatLanes b) { return a.v - b.v; }
+    friend FloatLanes operator*(FloatLanes a, FloatLanes b) { return a.v * b.v; }
+    friend FloatLanes operator/(FloatLanes a, FloatLanes b) { return a.v / b.v; }
+
+    static FloatLanes Min(FloatLanes a, FloatLanes b) { return a.v < b.v ? a.v : b.v; }
+    static FloatLanes Max(FloatLanes a, FloatLanes b) { return a.v > b.v ? a.v : b.v; }
+    static FloatLanes Sqrt(FloatLanes a) { return std::sqrt(a.v); }
+    static FloatLanes Floor(FloatLanes a) { return std::floor(a.v); }
+
+    // masks are 1.0 (true) or 0.0 (false) in the scalar fallback
+    static FloatLanes Less(FloatLanes a, FloatLanes b) { return a.v < b.v ? 1.0f : 0.0f; }
+    static FloatLanes LessEqual(FloatLanes a, FloatLanes b) { return a.v <= b.v ? 1.0f : 0.0f; }
+    static FloatLanes Greater(FloatLanes a, FloatLanes b) { return a.v > b.v ? 1.0f : 0.0f; }
+    static FloatLanes GreaterEqual(FloatLanes a, FloatLanes b) { return a.v >= b.v ? 1.0f : 0.0f; }
+    static FloatLanes And(FloatLanes a, FloatLanes b) { return a.v * b.v; }
+    static FloatLanes Select(FloatLanes mask, FloatLanes a, FloatLanes b) { return mask.v != 0.0f ? a.v : b.v; }
+    static int MoveMask(FloatLanes mask) { return mask.v != 0.0f ? 1 : 0; }
+#endif
+
+    FloatLanes& operator+=(FloatLanes other) { *this = *this + other; return *this; }
+    FloatLanes& operator*=(FloatLanes other) { *this = *this * other; return *this; }
+
+    static FloatLanes Clamp(FloatLanes a, float low, float high) { return Min(Max(a, Set1(low)), Set1(high)); }
+};
+
+// three FloatLanes, one per component
+struct Vec3Lanes
+{
+    FloatLanes x, y, z;
+
+    static Vec3Lanes Set1(float vx, float vy, float vz)
+    {
+        Vec3Lanes result = { FloatLanes::Set1(vx), FloatLanes::Set1(vy), FloatLanes::Set1(vz) };
+        return result;
+    }
+
+    friend Vec3Lanes operator+(const Vec3Lanes& a, const Vec3Lanes& b) { Vec3Lanes r = { a.x + b.x, a.y + b.y, a.z + b.z }; return r; }
+    friend Vec3Lanes operator-(const Vec3Lanes& a, const Vec3Lanes& b) { Vec3Lanes r = { a.x - b.x, a.y - b.y, a.z - b.z }; return r; }
+    friend Vec3Lanes operator*(const Vec3Lanes& a, FloatLanes s) { Vec3Lanes r = { a.x * s, a.y * s, a.z * s }; return r; }
+    friend Vec3Lanes operator*(const Vec3Lanes& a, const Vec3Lanes& b) { Vec3Lanes r = { a.x * b.x, a.y * b.y, a.z * b.z }; return r; }
+
+    static FloatLanes Dot(const Vec3Lanes& a, const Vec3Lanes& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    static FloatLanes Length(const Vec3Lanes& a) { return FloatLanes::Sqrt(Dot(a, a)); }
+    static Vec3Lanes Normalize(const Vec3Lanes& a) { return a * (FloatLanes::Set1(1.0f) / Length(a)); }
+};
+#endif
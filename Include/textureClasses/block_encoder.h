@@ -0,0 +1,554 @@
+#pragma once
+#ifndef BLOCK_ENCODER_H
+#define BLOCK_ENCODER_H
+
+#include <glad/glad.h>
+
+#include <renderClasses/gl_extensions.h>
+#include <simdClasses/float_lanes.h>
+#include <threadingClasses/worker_pool.h>
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+// GL_EXT_texture_compression_s3tc is not in the generated glad loader (RGTC and BPTC are core)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+// BC1: opaque RGB, 8 bytes per 4x4 block. BC4: one channel, 8 bytes. BC7: RGBA, 16 bytes.
+enum class BlockFormat
+{
+    None,
+    BC1,
+    BC4,
+    BC7
+};
+
+// Compresses RGBA8 images into 4x4 blocks, one block row per WorkerPool task.
+// Every block fits its endpoints along the principal axis of its texels, picks the nearest palette entry of
+// each texel (FloatLanes::Count texels at a time), then refits the endpoints to those indices by least
+// squares and keeps the refit when it lowers the error. BC4 encodes the Rec. 709 luminance of the texels and
+// BC7 only uses mode 6 (one subset, 7-bit RGBA endpoints with a shared bit, 4-bit indices), which suits smooth
+// and photographic content well at a fraction of the cost of a full mode search.
+class BlockEncoder
+{
+public:
+    // compression is on unless disabled (--no-texture-compression)
+    static bool Enabled()
+    {
+        return enabledSetting();
+    }
+
+    static void SetEnabled(bool enabled)
+    {
+        enabledSetting() = enabled;
+    }
+
+    // GL thread: whether the context can sample the format
+    static bool Supported(BlockFormat format)
+    {
+        switch (format)
+        {
+        case BlockFormat::BC1:
+            return hasGLExtension("GL_EXT_texture_compression_s3tc");
+        case BlockFormat::BC7:
+            return GLAD_GL_VERSION_4_2 || hasGLExtension("GL_ARB_texture_compression_bptc");
+        default:
+            // RGTC is core since GL 3.0
+            return true;
+        }
+    }
+
+    static GLenum InternalFormat(BlockFormat format)
+    {
+        switch (format)
+        {
+        case BlockFormat::BC1:
+            return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BlockFormat::BC4:
+            return GL_COMPRESSED_RED_RGTC1;
+        case BlockFormat::BC7:
+            return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        default:
+            return GL_RGBA8;
+        }
+    }
+
+    static size_t EncodedSize(BlockFormat format, int width, int height)
+    {
+        size_t blockBytes = format == BlockFormat::BC7 ? 16 : 8;
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+    }
+
+    // whether any texel is not fully opaque (BC1 would drop its alpha)
+    static bool HasTranslucency(const unsigned char* rgba, int width, int height)
+    {
+        size_t texelCount = (size_t)width * height;
+        for (size_t i = 0; i < texelCount; i++)
+        {
+            if (rgba[i * 4 + 3] != 255)
+                return true;
+        }
+        return false;
+    }
+
+    // any thread; the rows of blocks are spread over the pool when one is given
+    static std::vector<unsigned char> Encode(const unsigned char* rgba, int width, int height, BlockFormat format, WorkerPool* pool = NULL)
+    {
+        std::vector<unsigned char> output(EncodedSize(format, width, height));
+        int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+        size_t blockBytes = format == BlockFormat::BC7 ? 16 : 8;
+        unsigned char* destination = output.data();
+        auto encodeRow = [=](size_t blockY) {
+            BlockTexels block;
+            for (int blockX = 0; blockX < blocksX; blockX++)
+            {
+                fetchBlock(rgba, width, height, blockX, (int)blockY, block);
+                unsigned char* encoded = destination + ((size_t)blockY * blocksX + blockX) * blockBytes;
+                if (format == BlockFormat::BC1)
+                    encodeBC1(block, encoded);
+                else if (format == BlockFormat::BC4)
+                    encodeBC4(block, encoded);
+                else
+                    encodeBC7(block, encoded);
+            }
+        };
+        if (pool)
+            pool->ParallelFor((size_t)blocksY, encodeRow, 4);
+        else
+        {
+            for (int blockY = 0; blockY < blocksY; blockY++)
+                encodeRow((size_t)blockY);
+        }
+        return output;
+    }
+
+private:
+    static const int TEXEL_COUNT = 16;
+
+    // the 16 texels of a block, one array per channel, in the 0-255 range
+    struct BlockTexels
+    {
+        float Channels[4][TEXEL_COUNT];
+    };
+
+    // up to 16 colors a block can take, and the share of the second endpoint in each
+    struct Palette
+    {
+        int Size;
+        float Colors[16][4];
+        float Weights[16];
+    };
+
+    static bool& enabledSetting()
+    {
+        static bool enabled = true;
+        return enabled;
+    }
+
+    // texels outside the image repeat the last row and column
+    static void fetchBlock(const unsigned char* rgba, int width, int height, int blockX, int blockY, BlockTexels& block)
+    {
+        for (int y = 0; y < 4; y++)
+        {
+            int sourceY = blockY * 4 + y < height ? blockY * 4 + y : height - 1;
+            for (int x = 0; x < 4; x++)
+            {
+                int sourceX = blockX * 4 + x < width ? blockX * 4 + x : width - 1;
+                const unsigned char* texel = rgba + ((size_t)sourceY * width + sourceX) * 4;
+                for (int c = 0; c < 4; c++)
+                    block.Channels[c][y * 4 + x] = texel[c];
+            }
+        }
+    }
+
+    // the endpoints of the segment, along the principal axis of the texels, that covers them all
+    static void fitPrincipalAxis(const BlockTexels& block, int channelCount, float endpoint0[4], float endpoint1[4])
+    {
+        float mean[4] = {}, covariance[4][4] = {};
+        for (int c = 0; c < channelCount; c++)
+        {
+            for (int i = 0; i < TEXEL_COUNT; i++)
+                mean[c] += block.Channels[c][i];
+            mean[c] /= TEXEL_COUNT;
+        }
+        for (int i = 0; i < TEXEL_COUNT; i++)
+        {
+            for (int a = 0; a < channelCount; a++)
+            {
+                for (int b = a; b < channelCount; b++)
+                    covariance[a][b] += (block.Channels[a][i] - mean[a]) * (block.Channels[b][i] - mean[b]);
+            }
+        }
+        for (int a = 0; a < channelCount; a++)
+        {
+            for (int b = 0; b < a; b++)
+                covariance[a][b] = covariance[b][a];
+        }
+
+        // power iteration, started from the covariance column of the channel that varies most
+        int widest = 0;
+        for (int a = 1; a < channelCount; a++)
+            widest = covariance[a][a] > covariance[widest][widest] ? a : widest;
+        float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        if (covariance[widest][widest] > 0.0f)
+        {
+            for (int a = 0; a < channelCount; a++)
+                axis[a] = covariance[a][widest];
+        }
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float next[4] = {}, length = 0.0f;
+            for (int a = 0; a < channelCount; a++)
+            {
+                for (int b = 0; b < channelCount; b++)
+                    next[a] += covariance[a][b] * axis[b];
+                length = next[a] * next[a] > length ? next[a] * next[a] : length;
+            }
+            if (length < 1e-12f)
+                break;
+            length = std::sqrt(length);
+            for (int a = 0; a < channelCount; a++)
+                axis[a] = next[a] / length;
+        }
+        float axisLength = 0.0f;
+        for (int a = 0; a < channelCount; a++)
+            axisLength += axis[a] * axis[a];
+        axisLength = std::sqrt(axisLength);
+        for (int a = 0; a < channelCount; a++)
+            axis[a] /= axisLength;
+
+        // extent of the texels along the axis
+        FloatLanes lowest = FloatLanes::Set1(FLT_MAX), highest = FloatLanes::Set1(-FLT_MAX);
+        for (int base = 0; base < TEXEL_COUNT; base += FloatLanes::Count)
+        {
+            FloatLanes projection = FloatLanes::Set1(0.0f);
+            for (int c = 0; c < channelCount; c++)
+                projection += (FloatLanes::Load(block.Channels[c] + base) - FloatLanes::Set1(mean[c])) * FloatLanes::Set1(axis[c]);
+            lowest = FloatLanes::Min(lowest, projection);
+            highest = FloatLanes::Max(highest, projection);
+        }
+        float lowestValues[FloatLanes::Count], highestValues[FloatLanes::Count];
+        lowest.Store(lowestValues);
+        highest.Store(highestValues);
+        float low = lowestValues[0], high = highestValues[0];
+        for (int lane = 1; lane < FloatLanes::Count; lane++)
+        {
+            low = lowestValues[lane] < low ? lowestValues[lane] : low;
+            high = highestValues[lane] > high ? highestValues[lane] : high;
+        }
+
+        for (int c = 0; c < channelCount; c++)
+        {
+            endpoint0[c] = clampChannel(mean[c] + axis[c] * low);
+            endpoint1[c] = clampChannel(mean[c] + axis[c] * high);
+        }
+    }
+
+    // least-squares endpoints for fixed indices; false when every texel uses the same weight
+    static bool refitEndpoints(const BlockTexels& block, int channelCount, const Palette& palette, const int* indices, float endpoint0[4], float endpoint1[4])
+    {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f, weighted0[4] = {}, weighted1[4] = {};
+        for (int i = 0; i < TEXEL_COUNT; i++)
+        {
+            float b = palette.Weights[indices[i]], a = 1.0f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int c = 0; c < channelCount; c++)
+            {
+                weighted0[c] += a * block.Channels[c][i];
+                weighted1[c] += b * block.Channels[c][i];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) < 1e-6f)
+            return false;
+        for (int c = 0; c < channelCount; c++)
+        {
+            endpoint0[c] = clampChannel((bb * weighted0[c] - ab * weighted1[c]) / determinant);
+            endpoint1[c] = clampChannel((aa * weighted1[c] - ab * weighted0[c]) / determinant);
+        }
+        return true;
+    }
+
+    // the nearest palette entry of every texel; returns the summed squared error
+    static float selectIndices(const BlockTexels& block, int channelCount, const Palette& palette, int* indices)
+    {
+        float error = 0.0f;
+        for (int base = 0; base < TEXEL_COUNT; base += FloatLanes::Count)
+        {
+            FloatLanes channels[4];
+            for (int c = 0; c < channelCount; c++)
+                channels[c] = FloatLanes::Load(block.Channels[c] + base);
+            FloatLanes bestDistance = FloatLanes::Set1(FLT_MAX), bestIndex = FloatLanes::Set1(0.0f);
+            for (int entry = 0; entry < palette.Size; entry++)
+            {
+                FloatLanes distance = FloatLanes::Set1(0.0f);
+                for (int c = 0; c < channelCount; c++)
+                {
+                    FloatLanes difference = channels[c] - FloatLanes::Set1(palette.Colors[entry][c]);
+                    distance += difference * difference;
+                }
+                FloatLanes closer = FloatLanes::Less(distance, bestDistance);
+                bestDistance = FloatLanes::Select(closer, distance, bestDistance);
+                bestIndex = FloatLanes::Select(closer, FloatLanes::Set1((float)entry), bestIndex);
+            }
+            float distances[FloatLanes::Count], entries[FloatLanes::Count];
+            bestDistance.Store(distances);
+            bestIndex.Store(entries);
+            for (int lane = 0; lane < FloatLanes::Count; lane++)
+            {
+                indices[base + lane] = (int)entries[lane];
+                error += distances[lane];
+            }
+        }
+        return error;
+    }
+
+    static float clampChannel(float value)
+    {
+        return value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value);
+    }
+
+    // ---- BC1 ----
+
+    static std::uint16_t packRGB565(const float color[4])
+    {
+        int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+        int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+        int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+        return (std::uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    static void unpackRGB565(std::uint16_t packed, float color[4])
+    {
+        int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (float)((r << 3) | (r >> 2));
+        color[1] = (float)((g << 2) | (g >> 4));
+        color[2] = (float)((b << 3) | (b >> 2));
+        color[3] = 255.0f;
+    }
+
+    // four-color mode: requires color0 > color1
+    static void bc1Palette(std::uint16_t color0, std::uint16_t color1, Palette& palette)
+    {
+        palette.Size = 4;
+        unpackRGB565(color0, palette.Colors[0]);
+        unpackRGB565(color1, palette.Colors[1]);
+        for (int c = 0; c < 4; c++)
+        {
+            palette.Colors[2][c] = (2.0f * palette.Colors[0][c] + palette.Colors[1][c]) / 3.0f;
+            palette.Colors[3][c] = (palette.Colors[0][c] + 2.0f * palette.Colors[1][c]) / 3.0f;
+        }
+        palette.Weights[0] = 0.0f;
+        palette.Weights[1] = 1.0f;
+        palette.Weights[2] = 1.0f / 3.0f;
+        palette.Weights[3] = 2.0f / 3.0f;
+    }
+
+    // quantizes the endpoints and picks the indices; returns the error
+    static float bc1Candidate(const BlockTexels& block, const float endpoint0[4], const float endpoint1[4], std::uint16_t& color0, std::uint16_t& color1, int* indices)
+    {
+        color0 = packRGB565(endpoint0);
+        color1 = packRGB565(endpoint1);
+        if (color0 < color1)
+            std::swap(color0, color1);
+        Palette palette;
+        bc1Palette(color0, color1, palette);
+        // equal endpoints select the three-color mode, whose index 3 is black: use index 0 everywhere
+        if (color0 == color1)
+            palette.Size = 1;
+        return selectIndices(block, 3, palette, indices);
+    }
+
+    static void encodeBC1(const BlockTexels& block, unsigned char* output)
+    {
+        float endpoint0[4], endpoint1[4];
+        fitPrincipalAxis(block, 3, endpoint0, endpoint1);
+        std::uint16_t color0, color1;
+        int indices[TEXEL_COUNT];
+        float error = bc1Candidate(block, endpoint0, endpoint1, color0, color1, indices);
+
+        Palette palette;
+        bc1Palette(color0, color1, palette);
+        if (color0 != color1 && refitEndpoints(block, 3, palette, indices, endpoint0, endpoint1))
+        {
+            std::uint16_t refitColor0, refitColor1;
+            int refitIndices[TEXEL_COUNT];
+            float refitError = bc1Candidate(block, endpoint0, endpoint1, refitColor0, refitColor1, refitIndices);
+            if (refitError < error)
+            {
+                color0 = refitColor0;
+                color1 = refitColor1;
+                std::memcpy(indices, refitIndices, sizeof(indices));
+            }
+        }
+
+        std::uint32_t indexBits = 0;
+        for (int i = 0; i < TEXEL_COUNT; i++)
+            indexBits |= (std::uint32_t)indices[i] << (2 * i);
+        output[0] = (unsigned char)(color0 & 0xff);
+        output[1] = (unsigned char)(color0 >> 8);
+        output[2] = (unsigned char)(color1 & 0xff);
+        output[3] = (unsigned char)(color1 >> 8);
+        for (int i = 0; i < 4; i++)
+            output[4 + i] = (unsigned char)(indexBits >> (8 * i));
+    }
+
+    // ---- BC4 ----
+
+    // eight-value mode: red0 = brightest, red1 = darkest, then 6 interpolated values from red0 to red1
+    static void encodeBC4(const BlockTexels& block, unsigned char* output)
+    {
+        float values[TEXEL_COUNT];
+        for (int base = 0; base < TEXEL_COUNT; base += FloatLanes::Count)
+        {
+            FloatLanes luminance = FloatLanes::Load(block.Channels[0] + base) * FloatLanes::Set1(0.2126f)
+                + FloatLanes::Load(block.Channels[1] + base) * FloatLanes::Set1(0.7152f)
+                + FloatLanes::Load(block.Channels[2] + base) * FloatLanes::Set1(0.0722f);
+            FloatLanes::Floor(luminance + FloatLanes::Set1(0.5f)).Store(values + base);
+        }
+        float darkest = values[0], brightest = values[0];
+        for (int i = 1; i < TEXEL_COUNT; i++)
+        {
+            darkest = values[i] < darkest ? values[i] : darkest;
+            brightest = values[i] > brightest ? values[i] : brightest;
+        }
+        output[0] = (unsigned char)clampChannel(brightest);
+        output[1] = (unsigned char)clampChannel(darkest);
+
+        std::uint64_t indexBits = 0;
+        if (brightest > darkest)
+        {
+            // step along the ramp from the brightest value, then map ramp steps to BC4 indices (0, 2..7, 1)
+            float steps[TEXEL_COUNT];
+            FloatLanes scale = FloatLanes::Set1(7.0f / (brightest - darkest));
+            for (int base = 0; base < TEXEL_COUNT; base += FloatLanes::Count)
+            {
+                FloatLanes step = (FloatLanes::Set1(brightest) - FloatLanes::Load(values + base)) * scale;
+                FloatLanes::Floor(step + FloatLanes::Set1(0.5f)).Store(steps + base);
+            }
+            for (int i = 0; i < TEXEL_COUNT; i++)
+            {
+                int step = (int)steps[i];
+                std::uint64_t index = step == 0 ? 0 : (step == 7 ? 1 : step + 1);
+                indexBits |= index << (3 * i);
+            }
+        }
+        for (int i = 0; i < 6; i++)
+            output[2 + i] = (unsigned char)(indexBits >> (8 * i));
+    }
+
+    // ---- BC7 mode 6 ----
+
+    // 7-bit endpoint and its shared low bit, for the pair of bits that gives the lowest error over the 4 channels
+    static void quantizeBC7Endpoint(const float endpoint[4], int quantized[4], int& sharedBit)
+    {
+        float bestError = FLT_MAX;
+        for (int bit = 0; bit < 2; bit++)
+        {
+            int candidate[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++)
+            {
+                int value = (int)((endpoint[c] - bit) / 2.0f + 0.5f);
+                candidate[c] = value < 0 ? 0 : (value > 127 ? 127 : value);
+                float difference = (float)((candidate[c] << 1) | bit) - endpoint[c];
+                error += difference * difference;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                sharedBit = bit;
+                std::memcpy(quantized, candidate, sizeof(candidate));
+            }
+        }
+    }
+
+    static void bc7Palette(const int quantized0[4], int sharedBit0, const int quantized1[4], int sharedBit1, Palette& palette)
+    {
+        static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+        palette.Size = 16;
+        for (int entry = 0; entry < 16; entry++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                int value0 = (quantized0[c] << 1) | sharedBit0, value1 = (quantized1[c] << 1) | sharedBit1;
+                palette.Colors[entry][c] = (float)(((64 - weights[entry]) * value0 + weights[entry] * value1 + 32) >> 6);
+            }
+            palette.Weights[entry] = weights[entry] / 64.0f;
+        }
+    }
+
+    struct BC7Candidate
+    {
+        int Quantized[2][4];
+        int SharedBits[2];
+        int Indices[TEXEL_COUNT];
+        float Error;
+    };
+
+    static void bc7Candidate(const BlockTexels& block, const float endpoint0[4], const float endpoint1[4], BC7Candidate& candidate, Palette& palette)
+    {
+        quantizeBC7Endpoint(endpoint0, candidate.Quantized[0], candidate.SharedBits[0]);
+        quantizeBC7Endpoint(endpoint1, candidate.Quantized[1], candidate.SharedBits[1]);
+        bc7Palette(candidate.Quantized[0], candidate.SharedBits[0], candidate.Quantized[1], candidate.SharedBits[1], palette);
+        candidate.Error = selectIndices(block, 4, palette, candidate.Indices);
+    }
+
+    // appends the low `count` bits of value at bit `position` of a zeroed 128-bit block
+    static void writeBits(unsigned char* output, int& position, std::uint32_t value, int count)
+    {
+        for (int i = 0; i < count; i++, position++)
+        {
+            if (value & (1u << i))
+                output[position >> 3] |= (unsigned char)(1u << (position & 7));
+        }
+    }
+
+    static void encodeBC7(const BlockTexels& block, unsigned char* output)
+    {
+        float endpoint0[4], endpoint1[4];
+        fitPrincipalAxis(block, 4, endpoint0, endpoint1);
+        BC7Candidate best, refit;
+        Palette palette;
+        bc7Candidate(block, endpoint0, endpoint1, best, palette);
+        if (refitEndpoints(block, 4, palette, best.Indices, endpoint0, endpoint1))
+        {
+            bc7Candidate(block, endpoint0, endpoint1, refit, palette);
+            if (refit.Error < best.Error)
+                best = refit;
+        }
+
+        // the most significant index bit of texel 0 is implicit (zero): swap the endpoints when it is set
+        if (best.Indices[0] >= 8)
+        {
+            for (int c = 0; c < 4; c++)
+                std::swap(best.Quantized[0][c], best.Quantized[1][c]);
+            std::swap(best.SharedBits[0], best.SharedBits[1]);
+            for (int i = 0; i < TEXEL_COUNT; i++)
+                best.Indices[i] = 15 - best.Indices[i];
+        }
+
+        std::memset(output, 0, 16);
+        int position = 0;
+        writeBits(output, position, 1u << 6, 7); // mode 6
+        for (int c = 0; c < 4; c++)
+        {
+            writeBits(output, position, (std::uint32_t)best.Quantized[0][c], 7);
+            writeBits(output, position, (std::uint32_t)best.Quantized[1][c], 7);
+        }
+        writeBits(output, position, (std::uint32_t)best.SharedBits[0], 1);
+        writeBits(output, position, (std::uint32_t)best.SharedBits[1], 1);
+        writeBits(output, position, (std::uint32_t)best.Indices[0], 3);
+        for (int i = 1; i < TEXEL_COUNT; i++)
+            writeBits(output, position, (std::uint32_t)best.Indices[i], 4);
+    }
+};
+#endif
@@ -0,0 +1,234 @@
+#pragma once
+#ifndef MIP_CHAIN_H
+#define MIP_CHAIN_H
+
+#include <simdClasses/float_lanes.h>
+#include <textureClasses/texture_cache.h>
+#include <threadingClasses/worker_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Box: each texel averages the texels it covers. Kaiser: windowed sinc over 3 texels of the smaller level on
+// each side, sharper at distance than the box, with slight ringing at hard edges.
+enum class MipFilter
+{
+    Box,
+    Kaiser
+};
+
+// SRGB: the color channels are gamma-encoded (albedo), and are filtered in linear light.
+// Linear: every channel is filtered as stored (masks, intensities, normals).
+enum class ColorSpace
+{
+    Linear,
+    SRGB
+};
+
+// Builds the whole mip chain of an 8-bit image on the CPU, level 0 included, down to 1x1.
+// Levels are filtered in floating point, each from the previous one before it is rounded to 8 bits, one
+// axis at a time: a pass filters whole rows FloatLanes::Count floats at a time, and the image is transposed
+// between the two passes so that both axes use that same pass. Samples outside the image wrap around, as
+// every scene texture repeats. The rows of each pass are spread over the WorkerPool when one is given.
+class MipChainBuilder
+{
+public:
+    static MipFilter Filter()
+    {
+        return filterSetting();
+    }
+
+    static void SetFilter(MipFilter filter)
+    {
+        filterSetting() = filter;
+    }
+
+    static std::vector<TextureLevel> Build(const unsigned char* pixels, int width, int height, int components, ColorSpace colorSpace, WorkerPool* pool = NULL)
+    {
+        // alpha is never gamma-encoded
+        int colorChannels = colorSpace == ColorSpace::Linear ? 0 : (components == 2 || components == 4 ? components - 1 : components);
+
+        std::vector<TextureLevel> levels(1);
+        levels[0].Width = width;
+        levels[0].Height = height;
+        levels[0].Pixels.assign(pixels, pixels + (size_t)width * height * components);
+
+        std::vector<float> image((size_t)width * height * components);
+        const float* toLinear = srgbToLinearTable();
+        for (size_t i = 0; i < image.size(); i++)
+        {
+            int channel = (int)(i % components);
+            image[i] = channel < colorChannels ? toLinear[pixels[i]] : pixels[i] / 255.0f;
+        }
+
+        std::vector<float> scratch;
+        while (width > 1 || height > 1)
+        {
+            int nextWidth = width > 1 ? width / 2 : 1, nextHeight = height > 1 ? height / 2 : 1;
+            // rows: height x width -> nextHeight x width, then the transpose filtered the same way
+            std::vector<float> rows = filterColumns(image, (size_t)width * components, height, nextHeight, pool);
+            transpose(rows, scratch, width, nextHeight, components);
+            std::vector<float> columns = filterColumns(scratch, (size_t)nextHeight * components, width, nextWidth, pool);
+            transpose(columns, image, nextHeight, nextWidth, components);
+            width = nextWidth;
+            height = nextHeight;
+
+            TextureLevel level;
+            level.Width = width;
+            level.Height = height;
+            level.Pixels.resize(image.size());
+            for (size_t i = 0; i < image.size(); i++)
+            {
+                int channel = (int)(i % components);
+                level.Pixels[i] = channel < colorChannels ? linearToSrgb(image[i]) : (unsigned char)(std::min(std::max(image[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+            }
+            levels.push_back(std::move(level));
+        }
+        return levels;
+    }
+
+private:
+    // the source samples and weights of every output sample along one axis
+    struct FilterTaps
+    {
+        std::vector<int> First; // per output sample, index of its first tap; one more entry ends the last
+        std::vector<int> Sources;
+        std::vector<float> Weights;
+    };
+
+    static MipFilter& filterSetting()
+    {
+        static MipFilter filter = MipFilter::Kaiser;
+        return filter;
+    }
+
+    static const float* srgbToLinearTable()
+    {
+        static const std::vector<float> table = []() {
+            std::vector<float> values(256);
+            for (int i = 0; i < 256; i++)
+            {
+                float encoded = i / 255.0f;
+                values[i] = encoded <= 0.04045f ? encoded / 12.92f : std::pow((encoded + 0.055f) / 1.055f, 2.4f);
+            }
+            return values;
+        }();
+        return table.data();
+    }
+
+    // nearest 8-bit sRGB code: the first code whose midpoint with the next one is above the value
+    static unsigned char linearToSrgb(float value)
+    {
+        static const std::vector<float> midpoints = []() {
+            const float* toLinear = srgbToLinearTable();
+            std::vector<float> values(255);
+            for (int i = 0; i < 255; i++)
+                values[i] = (toLinear[i] + toLinear[i + 1]) * 0.5f;
+            return values;
+        }();
+        return (unsigned char)(std::upper_bound(midpoints.begin(), midpoints.end(), value) - midpoints.begin());
+    }
+
+    static double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; k++)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // weight of a source sample `distance` output samples away from the output sample's center
+    static double kaiserWeight(double distance)
+    {
+        const double radius = 3.0, alpha = 4.0;
+        if (std::fabs(distance) >= radius)
+            return 0.0;
+        double sinc = distance == 0.0 ? 1.0 : std::sin(3.14159265358979 * distance) / (3.14159265358979 * distance);
+        double window = distance / radius;
+        return sinc * besselI0(alpha * std::sqrt(1.0 - window * window)) / besselI0(alpha);
+    }
+
+    static FilterTaps makeTaps(int sourceSize, int outputSize)
+    {
+        FilterTaps taps;
+        double scale = (double)sourceSize / outputSize;
+        double support = Filter() == MipFilter::Kaiser ? 3.0 * scale : 0.5 * scale;
+        for (int output = 0; output < outputSize; output++)
+        {
+            taps.First.push_back((int)taps.Sources.size());
+            double center = (output + 0.5) * scale;
+            int first = (int)std::floor(center - support), last = (int)std::ceil(center + support);
+            double total = 0.0;
+            size_t begin = taps.Weights.size();
+            for (int source = first; source < last; source++)
+            {
+                double weight;
+                if (Filter() == MipFilter::Kaiser)
+                    weight = kaiserWeight((source + 0.5 - center) / scale);
+                else
+                    weight = std::max(0.0, std::min(source + 1.0, center + support) - std::max((double)source, center - support));
+                if (weight == 0.0)
+                    continue;
+                taps.Sources.push_back(((source % sourceSize) + sourceSize) % sourceSize);
+                taps.Weights.push_back((float)weight);
+                total += weight;
+            }
+            for (size_t i = begin; i < taps.Weights.size(); i++)
+                taps.Weights[i] = (float)(taps.Weights[i] / total);
+        }
+        taps.First.push_back((int)taps.Sources.size());
+        return taps;
+    }
+
+    // filters along the rows axis: every output row is a weighted sum of whole source rows
+    static std::vector<float> filterColumns(const std::vector<float>& source, size_t rowLength, int rowCount, int outputRowCount, WorkerPool* pool)
+    {
+        FilterTaps taps = makeTaps(rowCount, outputRowCount);
+        std::vector<float> output(rowLength * outputRowCount);
+        auto filterRow = [&](size_t outputRow) {
+            float* destination = &output[outputRow * rowLength];
+            size_t x = 0;
+            for (; x + FloatLanes::Count <= rowLength; x += FloatLanes::Count)
+            {
+                FloatLanes sum = FloatLanes::Set1(0.0f);
+                for (int tap = taps.First[outputRow]; tap < taps.First[outputRow + 1]; tap++)
+                    sum += FloatLanes::Set1(taps.Weights[tap]) * FloatLanes::Load(&source[(size_t)taps.Sources[tap] * rowLength + x]);
+                sum.Store(destination + x);
+            }
+            for (; x < rowLength; x++)
+            {
+                float sum = 0.0f;
+                for (int tap = taps.First[outputRow]; tap < taps.First[outputRow + 1]; tap++)
+                    sum += taps.Weights[tap] * source[(size_t)taps.Sources[tap] * rowLength + x];
+                destination[x] = sum;
+            }
+        };
+        if (pool)
+            pool->ParallelFor((size_t)outputRowCount, filterRow, 8);
+        else
+        {
+            for (int row = 0; row < outputRowCount; row++)
+                filterRow((size_t)row);
+        }
+        return output;
+    }
+
+    // height rows of width texels -> width rows of height texels
+    static void transpose(const std::vector<float>& source, std::vector<float>& output, int width, int height, int components)
+    {
+        output.resize(source.size());
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                for (int c = 0; c < components; c++)
+                    output[((size_t)x * height + y) * components + c] = source[((size_t)y * width + x) * components + c];
+            }
+        }
+    }
+};
+#endif
@@ -0,0 +1,210 @@
+#pragma once
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <fileClasses/file_system.h>
+#include <fileClasses/mapped_file.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// One mip level: tightly packed rows of texels, or the 4x4 blocks of a compressed format
+struct TextureLevel
+{
+    int Width;
+    int Height;
+    std::vector<unsigned char> Pixels;
+};
+
+// the sampling state of every scene texture: repeat, trilinear; single-channel compressed textures read as grey
+inline void setDefaultTextureParameters(GLenum internalFormat)
+{
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (internalFormat == GL_COMPRESSED_RED_RGTC1)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_ONE);
+    }
+}
+
+// On-disk cache of decoded textures with their whole mip chain, in the final GL format, so that a warm start
+// neither inflates PNGs nor generates mipmaps. A cache file is a header, a table of levels and the level
+// data; it is memory-mapped and every level goes to glTexImage2D straight from the mapping.
+// An entry remembers the size and modification time of its source image and is rebuilt when they change.
+// The variant tells apart several encodings of one source (e.g. raw and block-compressed), which have their own files.
+// Compressed entries hold the blocks of every level and are uploaded with glCompressedTexImage2D.
+class TextureCache
+{
+public:
+    static bool Enabled()
+    {
+        return enabledSetting();
+    }
+
+    static void SetEnabled(bool enabled)
+    {
+        enabledSetting() = enabled;
+    }
+
+    // GL thread: fills the texture from the cache; false on a miss or a stale entry
+    static bool Load(const std::string& sourcePath, std::uint32_t variant, unsigned int textureID)
+    {
+        FileStamp stamp;
+        if (!Enabled() || !fileStamp(sourcePath, stamp))
+            return false;
+        MappedFile file(pathFor(sourcePath, variant));
+        if (!file.IsOpen() || file.Size() < sizeof(FileHeader))
+            return false;
+
+        FileHeader header;
+        std::memcpy(&header, file.Data(), sizeof(header));
+        if (header.Magic != MAGIC || header.FormatVersion != FORMAT_VERSION
+            || header.SourceSize != stamp.Size || header.SourceModified != stamp.Modified || header.Variant != variant
+            || header.LevelCount == 0 || header.LevelCount > 32
+            || file.Size() < sizeof(FileHeader) + header.LevelCount * sizeof(FileLevel))
+            return false;
+        const FileLevel* levels = reinterpret_cast<const FileLevel*>(file.Data() + sizeof(FileHeader));
+        for (std::uint32_t i = 0; i < header.LevelCount; i++)
+        {
+            if (levels[i].Offset + levels[i].Size > file.Size())
+                return false;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (std::uint32_t i = 0; i < header.LevelCount; i++)
+        {
+            const unsigned char* data = file.Data() + levels[i].Offset;
+            if (header.Flags & FLAG_COMPRESSED)
+                glCompressedTexImage2D(GL_TEXTURE_2D, i, header.InternalFormat, levels[i].Width, levels[i].Height, 0, (GLsizei)levels[i].Size, data);
+            else
+                glTexImage2D(GL_TEXTURE_2D, i, header.InternalFormat, levels[i].Width, levels[i].Height, 0, header.Format, header.Type, data);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.LevelCount - 1);
+        setDefaultTextureParameters(header.InternalFormat);
+        return true;
+    }
+
+    // writes (or replaces) the cache entry of a source image, levels given as texels of format and type
+    static void Store(const std::string& sourcePath, std::uint32_t variant, GLenum internalFormat, GLenum format, GLenum type, const std::vector<TextureLevel>& levels)
+    {
+        store(sourcePath, variant, internalFormat, format, type, 0, levels);
+    }
+
+    // same for levels holding compressed blocks of internalFormat
+    static void StoreCompressed(const std::string& sourcePath, std::uint32_t variant, GLenum internalFormat, const std::vector<TextureLevel>& levels)
+    {
+        store(sourcePath, variant, internalFormat, 0, 0, FLAG_COMPRESSED, levels);
+    }
+
+private:
+    static const std::uint32_t MAGIC = 0x58544c4eu; // "NLTX"
+    static const std::uint32_t FORMAT_VERSION = 2;
+    // level data starts on 16-byte boundaries
+    static const std::uint64_t LEVEL_ALIGNMENT = 16;
+    static const std::uint32_t FLAG_COMPRESSED = 1;
+
+    struct FileHeader
+    {
+        std::uint32_t Magic;
+        std::uint32_t FormatVersion;
+        std::uint64_t SourceSize;
+        std::int64_t SourceModified;
+        std::uint32_t Variant;
+        std::uint32_t Flags;
+        std::uint32_t InternalFormat;
+        std::uint32_t Format;
+        std::uint32_t Type;
+        std::uint32_t Width;
+        std::uint32_t Height;
+        std::uint32_t LevelCount;
+    };
+
+    struct FileLevel
+    {
+        std::uint32_t Width;
+        std::uint32_t Height;
+        std::uint64_t Offset; // from the start of the file
+        std::uint64_t Size;
+    };
+
+    static void store(const std::string& sourcePath, std::uint32_t variant, GLenum internalFormat, GLenum format, GLenum type, std::uint32_t flags, const std::vector<TextureLevel>& levels)
+    {
+        FileStamp stamp;
+        if (!Enabled() || levels.empty() || !fileStamp(sourcePath, stamp))
+            return;
+
+        FileHeader header = { MAGIC, FORMAT_VERSION, stamp.Size, stamp.Modified, variant, flags, internalFormat, format, type,
+            (std::uint32_t)levels[0].Width, (std::uint32_t)levels[0].Height, (std::uint32_t)levels.size() };
+        std::vector<FileLevel> table(levels.size());
+        std::uint64_t offset = alignUp(sizeof(FileHeader) + table.size() * sizeof(FileLevel));
+        for (size_t i = 0; i < levels.size(); i++)
+        {
+            table[i].Width = (std::uint32_t)levels[i].Width;
+            table[i].Height = (std::uint32_t)levels[i].Height;
+            table[i].Offset = offset;
+            table[i].Size = levels[i].Pixels.size();
+            offset = alignUp(offset + table[i].Size);
+        }
+
+        makeDirectory(directory());
+        std::string path = pathFor(sourcePath, variant);
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR::TEXTURE_CACHE::CANNOT_WRITE: " << path << std::endl;
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(FileLevel));
+        for (size_t i = 0; i < levels.size(); i++)
+        {
+            std::uint64_t position = (std::uint64_t)file.tellp();
+            static const char zeros[LEVEL_ALIGNMENT] = {};
+            file.write(zeros, (std::streamsize)(table[i].Offset - position));
+            file.write(reinterpret_cast<const char*>(levels[i].Pixels.data()), levels[i].Pixels.size());
+        }
+    }
+
+    static bool& enabledSetting()
+    {
+        static bool enabled = true;
+        return enabled;
+    }
+
+    static std::uint64_t alignUp(std::uint64_t value)
+    {
+        return (value + LEVEL_ALIGNMENT - 1) / LEVEL_ALIGNMENT * LEVEL_ALIGNMENT;
+    }
+
+    static const char* directory()
+    {
+        return "texture_cache";
+    }
+
+    // one file per source path and variant: <64-bit FNV-1a of both>.nltx
+    static std::string pathFor(const std::string& sourcePath, std::uint32_t variant)
+    {
+        std::uint8_t variantBytes[4];
+        for (int i = 0; i < 4; i++)
+            variantBytes[i] = (std::uint8_t)(variant >> (8 * i));
+        std::uint64_t hash = fnv1a(variantBytes, sizeof(variantBytes), fnv1a(sourcePath.data(), sourcePath.size()));
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.nltx", (unsigned long long)hash);
+        return std::string(directory()) + "/" + name;
+    }
+};
+#endif
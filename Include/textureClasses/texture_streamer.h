@@ -0,0 +1,327 @@
+#pragma once
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+
+#include <threadingClasses/worker_pool.h>
+#include <textureClasses/block_encoder.h>
+#include <textureClasses/mip_chain.h>
+#include <textureClasses/texture_cache.h>
+
+#include "stb_image.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loads textures without stalling the render thread.
+// Request() returns a texture name at once, holding a 1x1 grey placeholder; the image is decoded on the
+// WorkerPool, which also builds its mip chain (MipChainBuilder) and, for a block format, compresses every
+// level (BlockEncoder). The worker then copies all the levels one after the other into a staging
+// pixel-unpack buffer that the GL thread keeps mapped. Update(), called once per frame on the GL thread,
+// uploads every finished image from that buffer, and recycles the buffer once a fence says the GPU has read it.
+// GL 3.3 has no persistent mapping, so a staging buffer is unmapped only for the upload and mapped again
+// right after its fence. Images larger than a staging buffer are uploaded from client memory instead.
+// A texture present in the TextureCache is filled synchronously by Request(), mips included, and never
+// reaches the workers; the others are written to the cache by their first upload.
+class TextureStreamer
+{
+public:
+    TextureStreamer(WorkerPool& pool, unsigned int stagingBufferCount = 4, size_t stagingBufferSize = 16 * 1024 * 1024)
+        : pool(pool), pendingDecodes(0), pendingUploads(0)
+    {
+        bc7Supported = BlockEncoder::Supported(BlockFormat::BC7);
+        slots.resize(stagingBufferCount);
+        for (StagingSlot& slot : slots)
+        {
+            glGenBuffers(1, &slot.Buffer);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.Buffer);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, stagingBufferSize, NULL, GL_STREAM_DRAW);
+            slot.Size = stagingBufferSize;
+            map(slot);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    ~TextureStreamer()
+    {
+        // the workers write into our buffers: let them finish first
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            decodesDone.wait(lock, [this]() { return pendingDecodes == 0; });
+        }
+        for (StagingSlot& slot : slots)
+        {
+            if (slot.Fence)
+                glDeleteSync(slot.Fence);
+            if (slot.Mapped)
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.Buffer);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            }
+            glDeleteBuffers(1, &slot.Buffer);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // a texture usable right away; its contents are replaced by the image once Update() uploads it.
+    // format is a wish: it falls back to BC7 and then to uncompressed texels when the context lacks it.
+    // colorSpace tells how the mip levels are filtered.
+    unsigned int Request(const char* path, BlockFormat format = BlockFormat::None, ColorSpace colorSpace = ColorSpace::Linear)
+    {
+        format = resolveFormat(format);
+        // the cache keeps one entry per encoding and mip filtering of an image
+        std::uint32_t variant = (std::uint32_t)format | ((std::uint32_t)colorSpace << 8) | ((std::uint32_t)MipChainBuilder::Filter() << 16);
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        if (TextureCache::Load(path, variant, textureID))
+            return textureID;
+
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        const unsigned char placeholder[4] = { 128, 128, 128, 255 };
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pendingDecodes++;
+        }
+        pendingUploads++;
+        std::string imagePath = path;
+        pool.Submit([this, textureID, imagePath, format, colorSpace, variant]() { decode(textureID, imagePath, format, colorSpace, variant); });
+        return textureID;
+    }
+
+    // GL thread, once per frame: uploads the images decoded since the last call and recycles staging buffers.
+    // Returns the number of textures uploaded; each upload binds its texture to the active unit.
+    unsigned int Update()
+    {
+        recycleStagingBuffers();
+
+        std::vector<DecodedImage> images;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            images.swap(decoded);
+        }
+        for (DecodedImage& image : images)
+        {
+            upload(image);
+            pendingUploads--;
+        }
+        return (unsigned int)images.size();
+    }
+
+    // blocks until every requested texture is uploaded (the headless benchmark must not render placeholders)
+    void WaitAll()
+    {
+        while (pendingUploads > 0)
+        {
+            Update();
+            if (pendingUploads > 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    // textures requested and not uploaded yet
+    unsigned int PendingCount() const
+    {
+        return pendingUploads;
+    }
+
+private:
+    struct StagingSlot
+    {
+        unsigned int Buffer = 0;
+        size_t Size = 0;
+        void* Mapped = NULL;      // valid while the slot is free or claimed
+        bool Claimed = false;     // a worker is writing into Mapped, or the upload is pending
+        GLsync Fence = NULL;      // set while the GPU may still read the buffer
+    };
+
+    struct DecodedImage
+    {
+        unsigned int Texture;
+        std::string Path;
+        std::uint32_t Variant;
+        int Components;
+        BlockFormat Format;       // the encoding of the levels, None for texels
+        int Slot;                 // staging buffer holding all the levels, or -1
+        std::vector<TextureLevel> Levels; // empty when the image failed to load
+    };
+
+    WorkerPool& pool;
+    std::vector<StagingSlot> slots;
+    std::mutex mutex;             // guards slot claims, decoded and pendingDecodes
+    std::condition_variable decodesDone;
+    std::vector<DecodedImage> decoded;
+    unsigned int pendingDecodes;
+    unsigned int pendingUploads;  // GL thread only
+    bool bc7Supported;
+
+    void map(StagingSlot& slot)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.Buffer);
+        slot.Mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, slot.Size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    }
+
+    BlockFormat resolveFormat(BlockFormat format) const
+    {
+        if (format == BlockFormat::None || !BlockEncoder::Enabled())
+            return BlockFormat::None;
+        if (BlockEncoder::Supported(format))
+            return format;
+        // BC7 stores everything BC1 does
+        if (format == BlockFormat::BC1 && bc7Supported)
+            return BlockFormat::BC7;
+        return BlockFormat::None;
+    }
+
+    // worker thread
+    void decode(unsigned int textureID, const std::string& path, BlockFormat format, ColorSpace colorSpace, std::uint32_t variant)
+    {
+        DecodedImage image = { textureID, path, variant, 0, format, -1, std::vector<TextureLevel>() };
+        int width = 0, height = 0;
+        // the block encoder takes RGBA texels
+        unsigned char* data = stbi_load(path.c_str(), &width, &height, &image.Components, format == BlockFormat::None ? 0 : 4);
+        if (data)
+        {
+            if (format != BlockFormat::None)
+                image.Components = 4;
+            // BC1 would lose the alpha channel
+            if (format == BlockFormat::BC1 && bc7Supported && BlockEncoder::HasTranslucency(data, width, height))
+                image.Format = BlockFormat::BC7;
+            image.Levels = MipChainBuilder::Build(data, width, height, image.Components, colorSpace, &pool);
+            stbi_image_free(data);
+
+            size_t byteCount = 0;
+            for (TextureLevel& level : image.Levels)
+            {
+                if (image.Format != BlockFormat::None)
+                    level.Pixels = BlockEncoder::Encode(level.Pixels.data(), level.Width, level.Height, image.Format, &pool);
+                byteCount += level.Pixels.size();
+            }
+            StagingSlot* slot = claimStagingSlot(byteCount, image.Slot);
+            if (slot)
+            {
+                unsigned char* destination = static_cast<unsigned char*>(slot->Mapped);
+                for (const TextureLevel& level : image.Levels)
+                {
+                    std::memcpy(destination, level.Pixels.data(), level.Pixels.size());
+                    destination += level.Pixels.size();
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        decoded.push_back(std::move(image));
+        pendingDecodes--;
+        if (pendingDecodes == 0)
+            decodesDone.notify_all();
+    }
+
+    // worker thread: the first free staging buffer of at least byteCount bytes, or NULL
+    StagingSlot* claimStagingSlot(size_t byteCount, int& slotIndex)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            if (!slots[i].Claimed && slots[i].Mapped != NULL && slots[i].Size >= byteCount)
+            {
+                slots[i].Claimed = true;
+                slotIndex = (int)i;
+                return &slots[i];
+            }
+        }
+        return NULL;
+    }
+
+    // GL thread
+    void upload(DecodedImage& image)
+    {
+        if (image.Levels.empty())
+        {
+            std::cout << "Texture failed to load at path: " << image.Path << std::endl;
+            return;
+        }
+
+        if (image.Slot >= 0)
+        {
+            StagingSlot& slot = slots[image.Slot];
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.Buffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            slot.Mapped = NULL;
+        }
+
+        GLenum format = GL_RGBA, internalFormat = GL_RGBA8;
+        if (image.Format != BlockFormat::None)
+            internalFormat = BlockEncoder::InternalFormat(image.Format);
+        else if (image.Components == 1)
+            format = GL_RED, internalFormat = GL_R8;
+        else if (image.Components == 2)
+            format = GL_RG, internalFormat = GL_RG8;
+        else if (image.Components == 3)
+            format = GL_RGB, internalFormat = GL_RGB8;
+
+        glBindTexture(GL_TEXTURE_2D, image.Texture);
+        // rows of 1 or 3 components are not 4-byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        size_t offset = 0;
+        for (size_t i = 0; i < image.Levels.size(); i++)
+        {
+            const TextureLevel& level = image.Levels[i];
+            // the level's offset in the bound pixel-unpack buffer, or client memory
+            const void* data = image.Slot >= 0 ? reinterpret_cast<const void*>(offset) : level.Pixels.data();
+            if (image.Format != BlockFormat::None)
+                glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, internalFormat, level.Width, level.Height, 0, (GLsizei)level.Pixels.size(), data);
+            else
+                glTexImage2D(GL_TEXTURE_2D, (GLint)i, internalFormat, level.Width, level.Height, 0, format, GL_UNSIGNED_BYTE, data);
+            offset += level.Pixels.size();
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.Levels.size() - 1);
+        setDefaultTextureParameters(internalFormat);
+
+        if (image.Format != BlockFormat::None)
+            TextureCache::StoreCompressed(image.Path, image.Variant, internalFormat, image.Levels);
+        else
+            TextureCache::Store(image.Path, image.Variant, internalFormat, format, GL_UNSIGNED_BYTE, image.Levels);
+
+        if (image.Slot >= 0)
+        {
+            // the buffer goes back to the workers once the GPU has consumed it
+            slots[image.Slot].Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+    }
+
+    // GL thread: maps again the staging buffers whose upload has completed on the GPU
+    void recycleStagingBuffers()
+    {
+        for (StagingSlot& slot : slots)
+        {
+            if (!slot.Fence)
+                continue;
+            GLenum status = glClientWaitSync(slot.Fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                continue;
+            glDeleteSync(slot.Fence);
+            slot.Fence = NULL;
+            map(slot);
+            std::lock_guard<std::mutex> lock(mutex);
+            slot.Claimed = false;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+};
+#endif
@@ -0,0 +1,138 @@
+#pragma once
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads consuming a shared task queue.
+// Submit queues a task and returns immediately; ParallelFor splits an index range over the workers
+// and the calling thread, and returns once every index has been processed.
+class WorkerPool
+{
+public:
+    // threadCount 0 uses one worker per hardware thread, minus the calling thread
+    explicit WorkerPool(unsigned int threadCount = 0) : stopping(false)
+    {
+        if (threadCount == 0)
+        {
+            unsigned int hardwareThreads = std::thread::hardware_concurrency();
+            threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+        }
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this]() { workerLoop(); });
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        queueCondition.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    unsigned int ThreadCount() const
+    {
+        return (unsigned int)workers.size();
+    }
+
+    void Submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            tasks.push_back(std::move(task));
+        }
+        queueCondition.notify_one();
+    }
+
+    // calls body(i) for every i in [0, count), indices being claimed in batches of grainSize.
+    // Safe to call from a worker: the caller processes batches itself and only waits for batches already claimed.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& body, size_t grainSize = 1)
+    {
+        if (count == 0)
+            return;
+        if (grainSize == 0)
+            grainSize = 1;
+
+        // shared with the helper tasks, which may start after this call returned and then find nothing left to claim
+        struct SharedRange
+        {
+            std::atomic<size_t> next;
+            size_t completed;
+            size_t count;
+            size_t grainSize;
+            const std::function<void(size_t)>* body;
+            std::mutex doneMutex;
+            std::condition_variable doneCondition;
+        };
+        std::shared_ptr<SharedRange> range = std::make_shared<SharedRange>();
+        range->next.store(0);
+        range->completed = 0;
+        range->count = count;
+        range->grainSize = grainSize;
+        range->body = &body;
+
+        auto run = [](SharedRange& shared) {
+            for (;;)
+            {
+                size_t begin = shared.next.fetch_add(shared.grainSize);
+                if (begin >= shared.count)
+                    return;
+                size_t end = begin + shared.grainSize < shared.count ? begin + shared.grainSize : shared.count;
+                for (size_t i = begin; i < end; i++)
+                    (*shared.body)(i);
+
+                std::lock_guard<std::mutex> lock(shared.doneMutex);
+                shared.completed += end - begin;
+                if (shared.completed == shared.count)
+                    shared.doneCondition.notify_all();
+            }
+        };
+
+        size_t batches = (count + grainSize - 1) / grainSize;
+        size_t helpers = batches - 1 < workers.size() ? batches - 1 : workers.size();
+        for (size_t i = 0; i < helpers; i++)
+            Submit([range, run]() { run(*range); });
+
+        run(*range);
+        std::unique_lock<std::mutex> lock(range->doneMutex);
+        range->doneCondition.wait(lock, [&range]() { return range->completed == range->count; });
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping;
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+#endif
@@ -6,22 +6,66 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <shaderClasses/shader_s.h>
+#include <shaderClasses/shader_manager.h>
+#include <shaderClasses/uniform_buffer.h>
+#include <shaderClasses/uniform_blocks.h>
 #include <cameraClasses/camera.h>
+#include <meshClasses/mesh_buffers.h>
+#include <meshClasses/mesh_file.h>
+#include <sceneClasses/cube_field.h>
+#include <sceneClasses/cube_mesh.h>
+#include <sceneClasses/negative_light.h>
+#include <sceneClasses/point_light_field.h>
+#include <sceneClasses/light_cluster_grid.h>
+#include <sceneClasses/transform_stage.h>
+#include <sceneClasses/frustum_culler.h>
+#include <sceneClasses/occlusion_culler.h>
+#include <renderClasses/offscreen_framebuffer.h>
+#include <renderClasses/cluster_light_buffers.h>
+#include <renderClasses/gpu_culler.h>
+#include <renderClasses/depth_pyramid.h>
+#include <renderClasses/render_queue.h>
+#include <renderClasses/gl_state_cache.h>
+#include <textureClasses/texture_streamer.h>
+#include <profilingClasses/frame_stats.h>
+#include <profilingClasses/trace_profiler.h>
+#include <profilingClasses/gpu_timer.h>
+#include <rasterizerClasses/software_rasterizer.h>
+#include <threadingClasses/worker_pool.h>
+#include <imageClasses/ppm_image.h>
 
 #include <iostream>
 #include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
 
 #include "stb_image.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void processInput(GLFWwindow* window);
-unsigned int loadTexture(const char* path);
+void runUniformUploadBenchmark(const Shader& shader, unsigned int objectCount);
+void applyBenchmarkCameraPath(unsigned int frameIndex, unsigned int frameCount);
+int runSoftwareRenderer(unsigned int frameCount, unsigned int cubeCount, const std::string& outputPath);
 
 // settings
 const unsigned int SCR_WIDTH = 1000;
 const unsigned int SCR_HEIGHT = 1000;
+unsigned int framebufferWidth = SCR_WIDTH;
+unsigned int framebufferHeight = SCR_HEIGHT;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.0f;
+
+// Headless benchmark: simulated time step, so every run renders the same frames
+const double headlessFrameTimeStep = 1.0 / 60.0;
 
 // Camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
@@ -35,17 +79,137 @@ double lastFrameTimeValue = 0.0; // Time of last frame
 // lighting
 glm::vec3 lightAndLampPosition(1.2f, 1.0f, 2.0f);
 
-// Rotation parameters
-const float orbitRadius = 3.0f;
-const float rotationSpeed = 1.2f; // Radians per second
+// depth pre-pass: the cubes are first drawn depth only, then shaded once per pixel (--depth-prepass, toggled with P)
+bool depthPrepass = false;
+
+// Uniform handles, hashed at compile time
+namespace Uniforms
+{
+    constexpr UniformHandle materialDiffuseMap("material.diffuseMap");
+    constexpr UniformHandle materialSpecularMap("material.specularMap");
+    constexpr UniformHandle clusterRecords("clusterRecords");
+    constexpr UniformHandle clusterLightIndices("clusterLightIndices");
+    constexpr UniformHandle pointLights("pointLights");
+    constexpr UniformHandle modelMatrix("modelMatrix");
+    constexpr UniformHandle modelViewMatrix("modelViewMatrix");
+    constexpr UniformHandle normalMatrix("normalMatrix");
+    constexpr UniformHandle lightCubeColor("lightCubeColor");
+}
+
+// How the cube field reaches the GPU
+enum class CubeRenderPath {
+    PerCube,        // one draw call per cube, transforms as uniforms
+    Instanced,      // one instanced draw, static world matrices, view transform in the vertex shader
+    CpuTransform,   // one instanced draw, model-view and normal matrices streamed every frame by the TransformStage
+    GpuDriven       // OpenGL 4.3: culled by a compute shader into one indirect draw, nothing per object on the CPU
+};
 
-int main()
+int main(int argc, char* argv[])
 {
+    bool uniformBenchmark = false;
+    bool headless = false;
+    bool software = false;
+    std::string statsCsvPath, statsJsonPath, tracePath, outputPath, modelPath, convertMeshSource, convertMeshOutput;
+    unsigned int headlessFrameCount = 500;
+    CubeRenderPath renderPath = CubeRenderPath::Instanced;
+    unsigned int cubeCount = 10;
+    unsigned int pointLightCount = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--uniform-benchmark") == 0)
+            uniformBenchmark = true;
+        else if (std::strcmp(argv[i], "--headless") == 0)
+            headless = true;
+        else if (std::strcmp(argv[i], "--software") == 0)
+            software = true;
+        else if (std::strcmp(argv[i], "--no-shader-cache") == 0)
+            ProgramBinaryCache::SetEnabled(false);
+        else if (std::strcmp(argv[i], "--no-texture-cache") == 0)
+            TextureCache::SetEnabled(false);
+        else if (std::strcmp(argv[i], "--no-frustum-culling") == 0)
+            FrustumCuller::SetEnabled(false);
+        else if (std::strcmp(argv[i], "--no-draw-sorting") == 0)
+            RenderQueue::SetEnabled(false);
+        else if (std::strcmp(argv[i], "--occlusion-culling") == 0)
+            OcclusionCuller::SetEnabled(true);
+        else if (std::strcmp(argv[i], "--depth-prepass") == 0)
+            depthPrepass = true;
+        else if (std::strcmp(argv[i], "--no-texture-compression") == 0)
+            BlockEncoder::SetEnabled(false);
+        else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (std::strcmp(argv[i], "--model") == 0 && i + 1 < argc)
+            modelPath = argv[++i];
+        else if (std::strcmp(argv[i], "--convert-mesh") == 0 && i + 2 < argc)
+        {
+            convertMeshSource = argv[++i];
+            convertMeshOutput = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--stats-csv") == 0 && i + 1 < argc)
+            statsCsvPath = argv[++i];
+        else if (std::strcmp(argv[i], "--stats-json") == 0 && i + 1 < argc)
+            statsJsonPath = argv[++i];
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            tracePath = argv[++i];
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            headlessFrameCount = (unsigned int)std::strtoul(argv[++i], NULL, 10);
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+        {
+            unsigned int width = 0, height = 0;
+            if (std::sscanf(argv[++i], "%ux%u", &width, &height) == 2 && width > 0 && height > 0)
+            {
+                framebufferWidth = width;
+                framebufferHeight = height;
+            }
+            else
+                std::cout << "Invalid size, expected WIDTHxHEIGHT: " << argv[i] << std::endl;
+        }
+        else if (std::strcmp(argv[i], "--cubes") == 0 && i + 1 < argc)
+            cubeCount = (unsigned int)std::strtoul(argv[++i], NULL, 10);
+        else if (std::strcmp(argv[i], "--lights") == 0 && i + 1 < argc)
+            pointLightCount = (unsigned int)std::strtoul(argv[++i], NULL, 10);
+        else if (std::strcmp(argv[i], "--render-path") == 0 && i + 1 < argc)
+        {
+            const char* pathName = argv[++i];
+            if (std::strcmp(pathName, "per-cube") == 0)
+                renderPath = CubeRenderPath::PerCube;
+            else if (std::strcmp(pathName, "instanced") == 0)
+                renderPath = CubeRenderPath::Instanced;
+            else if (std::strcmp(pathName, "cpu-transform") == 0)
+                renderPath = CubeRenderPath::CpuTransform;
+            else if (std::strcmp(pathName, "gpu-driven") == 0)
+                renderPath = CubeRenderPath::GpuDriven;
+            else
+                std::cout << "Unknown render path: " << pathName << std::endl;
+        }
+        else if (std::strcmp(argv[i], "--mip-filter") == 0 && i + 1 < argc)
+        {
+            const char* filterName = argv[++i];
+            if (std::strcmp(filterName, "box") == 0)
+                MipChainBuilder::SetFilter(MipFilter::Box);
+            else if (std::strcmp(filterName, "kaiser") == 0)
+                MipChainBuilder::SetFilter(MipFilter::Kaiser);
+            else
+                std::cout << "Unknown mip filter: " << filterName << std::endl;
+        }
+    }
+    // the benchmark measures the per-cube matrix upload, which only the per-cube shader has
+    if (uniformBenchmark)
+        renderPath = CubeRenderPath::PerCube;
+
+    // offline asset conversion: OBJ in, .nlmesh out
+    if (!convertMeshSource.empty())
+        return MeshFile::Convert(convertMeshSource, convertMeshOutput) ? 0 : -1;
+
+    // the software renderer needs no window and no GL context
+    if (software)
+        return runSoftwareRenderer(headlessFrameCount, cubeCount, outputPath);
 
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    // compute shaders and indirect draws need OpenGL 4.3, everything else runs on 3.3
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, renderPath == CubeRenderPath::GpuDriven ? 4 : 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
@@ -53,9 +217,26 @@ int main()
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
+    // the headless benchmark renders into an offscreen framebuffer, the window only carries the context
+    if (headless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
     // glfw window creation
     // --------------------
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "negative-light-opengl", NULL, NULL);
+    GLFWwindow* window = glfwCreateWindow(framebufferWidth, framebufferHeight, "negative-light-opengl", NULL, NULL);
+    if (window == NULL && renderPath == CubeRenderPath::GpuDriven)
+    {
+        std::cout << "OpenGL 4.3 is not available, the gpu-driven render path falls back to instanced" << std::endl;
+        renderPath = CubeRenderPath::Instanced;
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        window = glfwCreateWindow(framebufferWidth, framebufferHeight, "negative-light-opengl", NULL, NULL);
+    }
+    if (window == NULL && headless)
+    {
+        // no display server: fall back to a software OSMesa context when GLFW was built with it
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+        window = glfwCreateWindow(framebufferWidth, framebufferHeight, "negative-light-opengl", NULL, NULL);
+    }
     if (window == NULL)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
@@ -63,21 +244,27 @@ int main()
         return -1;
     }
     glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-    // Get the resolution of the primary monitor, calculate the center position, 
-    // set the window position on the center of the screen
-    const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
-    int xCenterPosition = (mode->width - SCR_WIDTH) / 2;
-    int yCenterPosition = (mode->height - SCR_HEIGHT) / 2;
-    glfwSetWindowPos(window, xCenterPosition, yCenterPosition);
+    if (!headless)
+    {
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+
+        // Get the resolution of the primary monitor, calculate the center position, 
+        // set the window position on the center of the screen
+        const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+        int xCenterPosition = (mode->width - (int)framebufferWidth) / 2;
+        int yCenterPosition = (mode->height - (int)framebufferHeight) / 2;
+        glfwSetWindowPos(window, xCenterPosition, yCenterPosition);
 
-    // Capture mouse cursor
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        // Capture mouse cursor
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-    // Mouse scroll registration
-    glfwSetScrollCallback(window, scroll_callback);
+        // Mouse scroll registration
+        glfwSetScrollCallback(window, scroll_callback);
+
+        glfwSetKeyCallback(window, key_callback);
+    }
 
     // glad: load all OpenGL function pointers
     // ---------------------------------------
@@ -86,237 +273,578 @@ int main()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    // the context may still be older than asked for (the OSMesa fallback)
+    if (renderPath == CubeRenderPath::GpuDriven && !GpuCuller::Supported())
+    {
+        std::cout << "OpenGL 4.3 is not available, the gpu-driven render path falls back to instanced" << std::endl;
+        renderPath = CubeRenderPath::Instanced;
+    }
     // Enabling depth buffer
     glEnable(GL_DEPTH_TEST);
 
+    // start decoding the textures on the worker threads right away, they are uploaded as they become ready
+    WorkerPool workerPool;
+    std::unique_ptr<TextureStreamer> textureStreamer(new TextureStreamer(workerPool));
+    // the diffuse map is opaque sRGB color, the specular map a grey intensity
+    unsigned int diffuseMap = textureStreamer->Request("container2.png", BlockFormat::BC1, ColorSpace::SRGB);
+    unsigned int specularMap = textureStreamer->Request("container2_specular.png", BlockFormat::BC4, ColorSpace::Linear);
+
     // build and compile our shader program
     // ------------------------------------
-    Shader lightingShader("shaders/mainCubeVertexShader.glsl", "shaders/mainCubeFragmentShader.glsl");
-    Shader lampCubeShader("shaders/lampCubeVertexShader.glsl", "shaders/lampCubeFragmentShader.glsl");
+    const char* cubeVertexShaderPath = "shaders/mainCubeInstancedVertexShader.glsl";
+    if (renderPath == CubeRenderPath::PerCube)
+        cubeVertexShaderPath = "shaders/mainCubeVertexShader.glsl";
+    else if (renderPath == CubeRenderPath::CpuTransform)
+        cubeVertexShaderPath = "shaders/mainCubeViewSpaceVertexShader.glsl";
+    else if (renderPath == CubeRenderPath::GpuDriven)
+        cubeVertexShaderPath = "shaders/mainCubeGpuDrivenVertexShader.glsl";
+    // both programs are only submitted here; the driver compiles them while the buffers and textures are set up
+    double shaderSubmitStartTime = glfwGetTime();
+    ShaderManager shaderManager((GLADloadproc)glfwGetProcAddress);
+    ShaderManager::Handle lightingProgram = shaderManager.Submit(cubeVertexShaderPath, "shaders/mainCubeFragmentShader.glsl");
+    ShaderManager::Handle lampCubeProgram = shaderManager.Submit("shaders/lampCubeVertexShader.glsl", "shaders/lampCubeFragmentShader.glsl");
+    // the same vertex shader without any shading, for the depth pre-pass (the window can switch it on at any time).
+    // The shading pass then tests GL_EQUAL against the pre-pass depth, which only holds if both programs compute
+    // bit-identical positions: every cube vertex shader declares gl_Position invariant for this
+    ShaderManager::Handle depthOnlyProgram = 0;
+    if (depthPrepass || !headless)
+        depthOnlyProgram = shaderManager.Submit(cubeVertexShaderPath, "shaders/depthOnlyFragmentShader.glsl");
+    ShaderManager::Handle cullProgram = 0;
+    if (renderPath == CubeRenderPath::GpuDriven)
+        cullProgram = shaderManager.SubmitCompute("shaders/frustumCullComputeShader.glsl");
+    // the occlusion test refines the CPU frustum culler's list, so it needs that culler
+    const bool occlusionCulling = OcclusionCuller::Enabled() && FrustumCuller::Enabled() && renderPath != CubeRenderPath::GpuDriven;
+    ShaderManager::Handle depthPyramidProgram = 0;
+    if (occlusionCulling)
+        depthPyramidProgram = shaderManager.Submit("shaders/depthPyramidVertexShader.glsl", "shaders/depthPyramidFragmentShader.glsl");
+    double shaderSubmitTime = glfwGetTime() - shaderSubmitStartTime;
+
+    // uniform blocks shared by both programs: per-frame camera and light position, constant light properties
+    std::unique_ptr<UniformBuffer<FrameUniforms>> frameUniforms(new UniformBuffer<FrameUniforms>(FRAME_UNIFORMS_BINDING));
+    std::unique_ptr<UniformBuffer<LightingUniforms>> lightingUniforms(new UniformBuffer<LightingUniforms>(LIGHTING_UNIFORMS_BINDING));
+    std::unique_ptr<UniformBuffer<ClusterUniforms>> clusterUniforms(new UniformBuffer<ClusterUniforms>(CLUSTER_UNIFORMS_BINDING));
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
-    float vertices[] = {
-        // positions          // normals           // texture coords
-        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
-         0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
-         0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
-         0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
-
-        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
-         0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 1.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
-
-        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-        -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-
-         0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-         0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
-         0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-         0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-         0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-
-        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
-         0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
-         0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
-         0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
-
-        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
-         0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
-    };
+    CubeField cubeField(cubeCount);
+    TransformStage transformStage;
+    transformStage.SetObjects(cubeField.Instances);
 
-    glm::vec3 cubePositions[] = {
-    glm::vec3(0.0f,  0.0f,  0.0f),
-    glm::vec3(2.0f,  5.0f, -15.0f),
-    glm::vec3(-1.5f, -2.2f, -2.5f),
-    glm::vec3(-3.8f, -2.0f, -12.3f),
-    glm::vec3(2.4f, -0.4f, -3.5f),
-    glm::vec3(-1.7f,  3.0f, -7.5f),
-    glm::vec3(1.3f, -2.0f, -2.5f),
-    glm::vec3(1.5f,  2.0f, -2.5f),
-    glm::vec3(1.5f,  0.2f, -1.5f),
-    glm::vec3(-1.3f,  1.0f, -1.5f)
-    };
-
-    // first, configure the cube's VAO (and VBO)
-    unsigned int VBO, cubeVAO;
+    // extra point lights spread over the cube field, culled per froxel on the worker threads
+    glm::vec3 fieldMin = cubeField.Positions.empty() ? glm::vec3(0.0f) : cubeField.Positions[0], fieldMax = fieldMin;
+    for (const glm::vec3& position : cubeField.Positions)
+    {
+        fieldMin = glm::min(fieldMin, position);
+        fieldMax = glm::max(fieldMax, position);
+    }
+    PointLightField pointLightField(pointLightCount, fieldMin - glm::vec3(2.0f), fieldMax + glm::vec3(2.0f));
+    LightClusterGrid lightClusterGrid;
+    std::unique_ptr<ClusterLightBuffers> clusterLightBuffers(new ClusterLightBuffers(2));
+
+    // first, configure the cube's VAO: 24 packed vertices and 36 16-bit indices instead of 36 vertices of 8 floats
+    std::unique_ptr<MeshBuffers> cubeMesh(new MeshBuffers(buildIndexedMesh(CUBE_VERTICES, CUBE_VERTEX_COUNT, CUBE_VERTEX_STRIDE)));
+    // --model replaces the cubes (not the lamp) with an imported mesh, mapped from its .nlmesh and uploaded as is
+    std::unique_ptr<MeshBuffers> modelMesh;
+    float sceneMeshRadius = CUBE_BOUNDING_RADIUS;
+    if (!modelPath.empty())
+    {
+        double modelLoadStartTime = glfwGetTime();
+        MappedMesh mappedModel(MeshFile::Import(modelPath));
+        if (mappedModel.IsOpen())
+        {
+            modelMesh.reset(new MeshBuffers(mappedModel.Vertices(), mappedModel.VertexCount(), mappedModel.Indices(), mappedModel.IndexCount(), mappedModel.IndexType()));
+            const MeshFile::Header& header = mappedModel.FileHeader();
+            sceneMeshRadius = glm::length(glm::max(glm::abs(glm::make_vec3(header.BoundsMin)), glm::abs(glm::make_vec3(header.BoundsMax))));
+            std::cout << "Model " << modelPath << ": " << mappedModel.VertexCount() << " vertices, " << mappedModel.IndexCount() / 3
+                << " triangles, loaded in " << (glfwGetTime() - modelLoadStartTime) * 1000.0 << " ms" << std::endl;
+        }
+    }
+    const MeshBuffers& sceneMesh = modelMesh ? *modelMesh : *cubeMesh;
+
+    // bounding spheres of the scene objects, culled against the view frustum every frame, on the GPU for the gpu-driven path
+    const bool cpuCulling = FrustumCuller::Enabled() && renderPath != CubeRenderPath::GpuDriven;
+    FrustumCuller frustumCuller;
+    if (cpuCulling)
+        frustumCuller.SetObjects(cubeField.Instances, sceneMeshRadius);
+    std::unique_ptr<GpuCuller> gpuCuller;
+    if (renderPath == CubeRenderPath::GpuDriven)
+        gpuCuller.reset(new GpuCuller(cubeField.Instances, sceneMeshRadius, sceneMesh));
+    // then against the depth of a previous frame, reduced on the GPU and read back without stalling
+    OcclusionCuller occlusionCuller;
+    std::unique_ptr<DepthPyramid> depthPyramid;
+    if (occlusionCulling)
+        depthPyramid.reset(new DepthPyramid());
+    // the objects left, nearest first and grouped by program, vertex array and texture, so the depth test rejects
+    // hidden fragments before they are shaded (the gpu-driven path draws in the order its compute shader appends)
+    const bool drawSorting = RenderQueue::Enabled() && renderPath != CubeRenderPath::GpuDriven;
+    RenderQueue renderQueue;
+    // world matrices of the cubes to draw, in drawing order, for the instanced path
+    std::vector<CubeInstance> visibleInstances;
+
+    unsigned int cubeVAO;
     glGenVertexArrays(1, &cubeVAO);
-    glGenBuffers(1, &VBO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
     glBindVertexArray(cubeVAO);
+    // position, normal and texture attributes
+    sceneMesh.BindAttributes();
+
+    // per-instance model and normal matrices (a matrix attribute takes one location per column)
+    unsigned int instanceVBO;
+    glGenBuffers(1, &instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    if (renderPath == CubeRenderPath::CpuTransform)
+    {
+        // view-space transforms change with the camera, the buffer is refilled every frame
+        glBufferData(GL_ARRAY_BUFFER, transformStage.Count() * sizeof(ViewSpaceTransform), NULL, GL_STREAM_DRAW);
+        for (unsigned int column = 0; column < 4; column++)
+        {
+            glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(ViewSpaceTransform),
+                (void*)(offsetof(ViewSpaceTransform, ModelViewMatrix) + column * sizeof(glm::vec4)));
+            glEnableVertexAttribArray(3 + column);
+            glVertexAttribDivisor(3 + column, 1);
+        }
+        for (unsigned int column = 0; column < 3; column++)
+        {
+            glVertexAttribPointer(7 + column, 3, GL_FLOAT, GL_FALSE, sizeof(ViewSpaceTransform),
+                (void*)(offsetof(ViewSpaceTransform, NormalMatrix) + column * sizeof(glm::vec4)));
+            glEnableVertexAttribArray(7 + column);
+            glVertexAttribDivisor(7 + column, 1);
+        }
+    }
+    else if (renderPath != CubeRenderPath::GpuDriven)
+    {
+        // the cubes never move, so their world matrices are uploaded once, unless culling picks a subset or sorting
+        // reorders them every frame
+        if (renderPath == CubeRenderPath::Instanced && (cpuCulling || drawSorting))
+            glBufferData(GL_ARRAY_BUFFER, cubeField.Count() * sizeof(CubeInstance), NULL, GL_STREAM_DRAW);
+        else
+            glBufferData(GL_ARRAY_BUFFER, cubeField.Count() * sizeof(CubeInstance), cubeField.Instances.data(), GL_STATIC_DRAW);
+        for (unsigned int column = 0; column < 4; column++)
+        {
+            glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(CubeInstance),
+                (void*)(offsetof(CubeInstance, ModelMatrix) + column * sizeof(glm::vec4)));
+            glEnableVertexAttribArray(3 + column);
+            glVertexAttribDivisor(3 + column, 1);
+        }
+        for (unsigned int column = 0; column < 3; column++)
+        {
+            glVertexAttribPointer(7 + column, 3, GL_FLOAT, GL_FALSE, sizeof(CubeInstance),
+                (void*)(offsetof(CubeInstance, NormalMatrix) + column * sizeof(glm::vec3)));
+            glEnableVertexAttribArray(7 + column);
+            glVertexAttribDivisor(7 + column, 1);
+        }
+    }
 
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture attribute
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-
-    // second, configure the light's VAO (VBO stays the same; the vertices are the same for the light object which is also a 3D cube)
+    // second, configure the light's VAO (the buffers stay the same; the light object is also a 3D cube, that only needs positions)
     unsigned int lightCubeVAO;
     glGenVertexArrays(1, &lightCubeVAO);
     glBindVertexArray(lightCubeVAO);
+    cubeMesh->BindAttributes(false);
+
+    // frame statistics, reported periodically over the frames since the last report
+    FrameStats frameStats(headless ? std::max<size_t>(headlessFrameCount, 4096) : 4096);
+    const double statsReportInterval = 2.0;
+    double lastStatsReportTime = glfwGetTime();
+    size_t framesSinceStatsReport = 0;
+    // objects in the frustum in the last frame, before the occlusion test removes the hidden ones from that list
+    unsigned int frustumVisibleCount = 0;
+    // GPU time of the cube and lamp passes, reported with the CPU timings
+    std::unique_ptr<GpuTimer> gpuTimer(new GpuTimer());
+    // the render loop sets programs, vertex arrays, textures and depth state through it: only changes reach GL
+    GlStateCache stateCache;
+
+    const NegativeLightProperties negativeLight = sceneNegativeLight();
+
+    // shader configuration: the first use of the programs, wait for the driver here
+    // --------------------
+    double shaderWaitStartTime = glfwGetTime();
+    bool shadersReadyBeforeUse = shaderManager.IsReady(lightingProgram) && shaderManager.IsReady(lampCubeProgram);
+    Shader& lightingShader = shaderManager.Get(lightingProgram);
+    Shader& lampCubeShader = shaderManager.Get(lampCubeProgram);
+    std::cout << "Shaders: submitted in " << shaderSubmitTime * 1000.0 << " ms, waited " << (glfwGetTime() - shaderWaitStartTime) * 1000.0
+        << " ms at first use (parallel compile " << (shaderManager.ParallelCompile() ? "on" : "off") << ", "
+        << (shadersReadyBeforeUse ? "ready" : "not ready") << " before use, " << shaderManager.CachedCount() << " of "
+        << shaderManager.Count() << " from the program binary cache)" << std::endl;
+
+    lightingShader.bindUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+    lightingShader.bindUniformBlock("LightingUniforms", LIGHTING_UNIFORMS_BINDING);
+    lightingShader.bindUniformBlock("ClusterUniforms", CLUSTER_UNIFORMS_BINDING);
+    lampCubeShader.bindUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+    Shader* depthOnlyShader = NULL;
+    if (depthOnlyProgram)
+    {
+        depthOnlyShader = &shaderManager.Get(depthOnlyProgram);
+        depthOnlyShader->bindUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+    }
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    // note that we update the lamp's position attribute's stride to reflect the updated buffer data
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // FPS calculation variables
-    double lastTimeForFPS = glfwGetTime();
-    double deltaTimeForFPS = 0.0;
-    int nbFrames = 0;
+    lightingShader.use();
+    lightingShader.setInt(Uniforms::materialDiffuseMap, 0);
+    lightingShader.setInt(Uniforms::materialSpecularMap, 1);
+    lightingShader.setInt(Uniforms::clusterRecords, 2);
+    lightingShader.setInt(Uniforms::clusterLightIndices, 3);
+    lightingShader.setInt(Uniforms::pointLights, 4);
 
-    glm::vec3 lightColor{};
+    if (uniformBenchmark)
+    {
+        runUniformUploadBenchmark(lightingShader, 10000);
+        gpuTimer.reset();
+        frameUniforms.reset();
+        lightingUniforms.reset();
+        clusterUniforms.reset();
+        clusterLightBuffers.reset();
+        modelMesh.reset();
+        cubeMesh.reset();
+        textureStreamer.reset();
+        shaderManager.Clear();
+        glfwTerminate();
+        return 0;
+    }
 
-    // load textures (we now use a utility function to keep the code more organized)
-    // -----------------------------------------------------------------------------
-    unsigned int diffuseMap = loadTexture("container2.png");
-    unsigned int specularMap = loadTexture("container2_specular.png");
+    // headless benchmark state
+    std::unique_ptr<OffscreenFramebuffer> offscreenFramebuffer;
+    unsigned int headlessFrameIndex = 0;
+    if (headless)
+    {
+        offscreenFramebuffer.reset(new OffscreenFramebuffer((int)framebufferWidth, (int)framebufferHeight));
+        offscreenFramebuffer->bind();
+        // every benchmark frame must show the real textures
+        textureStreamer->WaitAll();
+        std::cout << "Headless benchmark: " << headlessFrameCount << " frames at " << framebufferWidth << "x" << framebufferHeight
+            << ", " << cubeField.Count() << " cubes, " << pointLightField.Count() << " point lights, renderer " << glGetString(GL_RENDERER) << std::endl;
+    }
 
-    // shader configuration
-    // --------------------
-    lightingShader.use();
-    lightingShader.setInt("material.diffuseMap", 0);
-    lightingShader.setInt("material.specularMap", 1);
+#if ENABLE_TRACE_PROFILER
+    TRACE_THREAD_NAME("render");
+    if (!tracePath.empty())
+        TraceProfiler::Start();
+#else
+    if (!tracePath.empty())
+        std::cout << "Tracing was compiled out (ENABLE_TRACE_PROFILER=0), --trace ignored" << std::endl;
+#endif
 
     // render loop
     // -----------
-    while (!glfwWindowShouldClose(window))
+    while (headless ? headlessFrameIndex < headlessFrameCount : !glfwWindowShouldClose(window))
     {
         // per-frame time logic
         // --------------------
-        double currentFrameTimeValue = glfwGetTime();
+        TRACE_ZONE("frame");
+        frameStats.BeginFrame();
+        gpuTimer->BeginFrame(frameStats);
+        double currentFrameTimeValue = headless ? headlessFrameIndex * headlessFrameTimeStep : glfwGetTime();
         deltaTime = currentFrameTimeValue - lastFrameTimeValue;
         lastFrameTimeValue = currentFrameTimeValue;
 
-        deltaTimeForFPS = currentFrameTimeValue - lastTimeForFPS;
-        nbFrames++;
-        if (deltaTimeForFPS >= 0.1) {
-            // Calculate FPS (frames per second)
-            double fps = nbFrames / deltaTimeForFPS;
-
-            // Print FPS to the same line with a carriage return and flush the stream
-            std::cout << "\r" << "FPS: " << fps << std::flush;
-
-            // Reset frame count and update the last time
-            nbFrames = 0;
-            lastTimeForFPS = currentFrameTimeValue;
-        }
-
         // input
         // -----
-        processInput(window);
+        frameStats.BeginPhase(PHASE_INPUT);
+        {
+            TRACE_ZONE("input");
+            if (headless)
+                applyBenchmarkCameraPath(headlessFrameIndex, headlessFrameCount);
+            else
+                processInput(window);
+        }
+        frameStats.EndPhase(PHASE_INPUT);
 
         // render
         // ------
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Update light position to rotate around the central cube
-        float angle = glfwGetTime() * rotationSpeed;
-        lightAndLampPosition.x = sin(angle) * orbitRadius;
-        lightAndLampPosition.y = sin(angle) * cos(angle)*2-0.5;
-        lightAndLampPosition.z = cos(angle) * orbitRadius - 2.0;
-
-        // be sure to activate shader when setting uniforms/drawing objects
-        lightingShader.use();
-        // lightingShader.setVec3("objectColor", 1.0f, 0.5f, 0.31f);
-        lightingShader.setVec3("lightPosition", lightAndLampPosition);
-        lightingShader.setVec3("viewPosition", camera.Position);
-
-        // material properties
-        lightingShader.setFloat("material.shininess", 32.0f);
-
-        lightColor = glm::vec3(1.0);
-
-        // The coefficients have to be * 1.0 or more in order for the negative light effect to work.
-        lightingShader.setVec3("lightProperties.ambient", lightColor * 1.0f);
-        lightingShader.setVec3("lightProperties.diffuse", lightColor * 1.5f);
-        lightingShader.setVec3("lightProperties.specular", lightColor * 1.0f);
-        lightingShader.setVec3("lightProperties.direction", -0.2f, -1.0f, -0.3f);
-
-        lightingShader.setFloat("lightProperties.attenuationConstantTerm", 1.0f);
-        lightingShader.setFloat("lightProperties.attenuationLinearTerm", 0.09f);
-        lightingShader.setFloat("lightProperties.attenuationQuadraticTerm", 0.032f);
+        glm::mat4 projectionMatrix, viewMatrix;
+        frameStats.BeginPhase(PHASE_UNIFORM_UPLOAD);
+        {
+            TRACE_ZONE("lighting uniforms");
+            // Update light position to rotate around the central cube
+            lightAndLampPosition = orbitingLightPosition(currentFrameTimeValue);
+
+            // view/projection transformations
+            projectionMatrix = glm::perspective(glm::radians(camera.FieldOfView), (float)framebufferWidth / (float)framebufferHeight, NEAR_PLANE, FAR_PLANE);
+            viewMatrix = camera.GetViewMatrix();
+
+            // one glBufferSubData per block, skipped when nothing changed (the light properties are uploaded once)
+            frameUniforms->Update(makeFrameUniforms(projectionMatrix, viewMatrix, camera.Position, lightAndLampPosition));
+            lightingUniforms->Update(makeLightingUniforms(negativeLight));
+
+            // textures decoded since the last frame
+            {
+                TRACE_ZONE("texture streaming");
+                if (textureStreamer->Update() > 0)
+                    stateCache.InvalidateTextures();
+            }
+
+            // froxel light lists for this frame's camera
+            {
+                TRACE_ZONE("light clusters");
+                pointLightField.Update(currentFrameTimeValue);
+                lightClusterGrid.SetProjection(projectionMatrix, NEAR_PLANE, FAR_PLANE, framebufferWidth, framebufferHeight);
+                lightClusterGrid.Build(pointLightField.Lights, viewMatrix, workerPool);
+                clusterLightBuffers->Upload(lightClusterGrid, stateCache);
+                clusterUniforms->Update(makeClusterUniforms(glm::uvec3(LightClusterGrid::GridX, LightClusterGrid::GridY, LightClusterGrid::GridZ),
+                    pointLightField.Count(), lightClusterGrid.SliceParameters(), lightClusterGrid.TileSize()));
+            }
+
+            // be sure to activate shader when setting uniforms/drawing objects
+            stateCache.UseProgram(lightingShader.ID);
+        }
+        frameStats.EndPhase(PHASE_UNIFORM_UPLOAD);
 
-        // view/projection transformations
-        glm::mat4 projectionMatrix = glm::perspective(glm::radians(camera.FieldOfView), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 viewMatrix = camera.GetViewMatrix();
+        // the objects to draw: those whose bounding sphere touches the frustum
+        frameStats.BeginPhase(PHASE_CULLING);
+        if (cpuCulling)
+        {
+            TRACE_ZONE("frustum culling");
+            frustumCuller.Cull(projectionMatrix * viewMatrix, &workerPool);
+            frustumVisibleCount = frustumCuller.VisibleCount();
+        }
+        if (occlusionCulling)
+        {
+            TRACE_ZONE("occlusion culling");
+            depthPyramid->Readback(occlusionCuller);
+            occlusionCuller.Cull(frustumCuller.Visible, frustumCuller);
+        }
+        else if (gpuCuller)
+        {
+            TRACE_ZONE("gpu culling dispatch");
+            gpuCuller->Cull(shaderManager.Get(cullProgram), projectionMatrix * viewMatrix);
+            stateCache.InvalidateProgram();
+            stateCache.UseProgram(lightingShader.ID);
+        }
+        frameStats.EndPhase(PHASE_CULLING);
 
-        lightingShader.setMat4("projectionMatrix", projectionMatrix);
-        lightingShader.setMat4("viewMatrix", viewMatrix);
+        // the objects to draw in order; NULL: all of them, in scene order
+        const std::vector<std::uint32_t>* drawList = cpuCulling ? &frustumCuller.Visible : NULL;
+        frameStats.BeginPhase(PHASE_SORTING);
+        if (drawSorting)
+        {
+            TRACE_ZONE("draw sorting");
+            // distance in front of the camera: minus the view-space z
+            const glm::vec4 depthRow = -glm::vec4(viewMatrix[0][2], viewMatrix[1][2], viewMatrix[2][2], viewMatrix[3][2]);
+            const unsigned int listCount = drawList ? (unsigned int)drawList->size() : cubeField.Count();
+            renderQueue.Clear();
+            for (unsigned int i = 0; i < listCount; i++)
+            {
+                std::uint32_t object = drawList ? (*drawList)[i] : i;
+                float viewDepth = glm::dot(depthRow, glm::vec4(cubeField.Positions[object], 1.0f));
+                renderQueue.Push(RenderQueue::MakeKey(lightingShader.ID, cubeVAO, diffuseMap, viewDepth), object);
+            }
+            renderQueue.Sort();
+            drawList = &renderQueue.Objects();
+        }
+        frameStats.EndPhase(PHASE_SORTING);
+        const unsigned int drawCount = drawList ? (unsigned int)drawList->size() : cubeField.Count();
 
-        // world transformation
-        glm::mat4 modelMatrix = glm::mat4(1.0f);
-        lightingShader.setMat4("modelMatrix", modelMatrix);
+        frameStats.BeginPhase(PHASE_UNIFORM_UPLOAD);
+        {
+            TRACE_ZONE("object transforms");
+            // per-object model-view and normal matrices
+            if (renderPath == CubeRenderPath::PerCube || renderPath == CubeRenderPath::CpuTransform)
+            {
+                if (drawList)
+                    transformStage.Update(viewMatrix, *drawList);
+                else
+                    transformStage.Update(viewMatrix);
+            }
+            if (renderPath == CubeRenderPath::CpuTransform)
+            {
+                // orphan the previous frame's storage so the upload never waits on the GPU
+                glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+                glBufferData(GL_ARRAY_BUFFER, cubeField.Count() * sizeof(ViewSpaceTransform), NULL, GL_STREAM_DRAW);
+                glBufferSubData(GL_ARRAY_BUFFER, 0, transformStage.Count() * sizeof(ViewSpaceTransform), transformStage.Output.data());
+            }
+            else if (renderPath == CubeRenderPath::Instanced && drawList)
+            {
+                visibleInstances.clear();
+                for (std::uint32_t object : *drawList)
+                    visibleInstances.push_back(cubeField.Instances[object]);
+                glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+                glBufferData(GL_ARRAY_BUFFER, cubeField.Count() * sizeof(CubeInstance), NULL, GL_STREAM_DRAW);
+                glBufferSubData(GL_ARRAY_BUFFER, 0, visibleInstances.size() * sizeof(CubeInstance), visibleInstances.data());
+            }
+        }
+        frameStats.EndPhase(PHASE_UNIFORM_UPLOAD);
+
+        // the cubes, with `shader` in use and the cube VAO bound
+        auto drawCubes = [&](const Shader& shader) {
+            if (renderPath == CubeRenderPath::PerCube)
+            {
+                for (unsigned int i = 0; i < transformStage.Count(); i++)
+                {
+                    const ViewSpaceTransform& transform = transformStage.Output[i];
+                    shader.setMat4(Uniforms::modelViewMatrix, glm::make_mat4(transform.ModelViewMatrix));
+                    const float* normalColumns = transform.NormalMatrix;
+                    shader.setMat3(Uniforms::normalMatrix, glm::mat3(
+                        glm::make_vec3(normalColumns), glm::make_vec3(normalColumns + 4), glm::make_vec3(normalColumns + 8)));
+
+                    sceneMesh.Draw();
+                }
+            }
+            else if (gpuCuller)
+            {
+                gpuCuller->Draw();
+            }
+            else
+            {
+                sceneMesh.DrawInstanced(drawCount);
+            }
+        };
+
+        frameStats.BeginPhase(PHASE_DRAW_SUBMISSION);
+        const bool prepassThisFrame = depthPrepass && depthOnlyShader;
+        if (prepassThisFrame)
+        {
+            TRACE_ZONE("depth pre-pass");
+            gpuTimer->BeginPass(GPU_PASS_DEPTH_PREPASS);
+            stateCache.UseProgram(depthOnlyShader->ID);
+            stateCache.SetColorMask(false);
+            stateCache.SetDepthTest(true);
+            stateCache.SetDepthFunc(GL_LESS);
+            stateCache.SetDepthMask(true);
+            stateCache.BindVertexArray(cubeVAO);
+            drawCubes(*depthOnlyShader);
+            gpuTimer->EndPass();
+        }
+        {
+            TRACE_ZONE("cube pass");
+            gpuTimer->BeginPass(GPU_PASS_CUBES);
+            stateCache.UseProgram(lightingShader.ID);
+            stateCache.SetColorMask(true);
+            stateCache.SetBlend(false);
+            stateCache.SetDepthTest(true);
+            // after a depth pre-pass the depth buffer holds the nearest surface: only its fragments get shaded
+            stateCache.SetDepthFunc(prepassThisFrame ? GL_EQUAL : GL_LESS);
+            stateCache.SetDepthMask(!prepassThisFrame);
+
+            stateCache.BindTexture(0, GL_TEXTURE_2D, diffuseMap);
+            stateCache.BindTexture(1, GL_TEXTURE_2D, specularMap);
+            clusterLightBuffers->Bind(stateCache);
+
+            // render the cubes
+            stateCache.BindVertexArray(cubeVAO);
+            drawCubes(lightingShader);
+            gpuTimer->EndPass();
+        }
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, diffuseMap);
+        // also draw the lamp object
+        {
+            TRACE_ZONE("lamp pass");
+            gpuTimer->BeginPass(GPU_PASS_LAMP);
+            stateCache.UseProgram(lampCubeShader.ID);
+            // also leaves the depth writes on for the next frame's glClear
+            stateCache.SetDepthFunc(GL_LESS);
+            stateCache.SetDepthMask(true);
+            glm::mat4 modelMatrix = glm::mat4(1.0f);
+            modelMatrix = glm::translate(modelMatrix, lightAndLampPosition);
+            modelMatrix = glm::scale(modelMatrix, glm::vec3(0.2f)); // a smaller cube
+            lampCubeShader.setMat4(Uniforms::modelMatrix, modelMatrix);
+        
+            lampCubeShader.setVec3(Uniforms::lightCubeColor, 0.0, 0.0, 0.0);
+        
+            stateCache.BindVertexArray(lightCubeVAO);
+            cubeMesh->Draw();
+            gpuTimer->EndPass();
+        }
 
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, specularMap);
+        // the depth the next frames' occlusion tests read
+        if (occlusionCulling)
+        {
+            TRACE_ZONE("depth pyramid");
+            depthPyramid->Build(shaderManager.Get(depthPyramidProgram), headless ? offscreenFramebuffer->ID : 0,
+                (int)framebufferWidth, (int)framebufferHeight, projectionMatrix * viewMatrix);
+            stateCache.Invalidate();
+        }
+        frameStats.EndPhase(PHASE_DRAW_SUBMISSION);
 
-        // render the cube
-        glBindVertexArray(cubeVAO);
-        for (unsigned int i = 0; i < 10; i++)
+        frameStats.BeginPhase(PHASE_SWAP);
         {
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, cubePositions[i]);
-            float angle = 20.0f * i;
-            model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-            lightingShader.setMat4("modelMatrix", model);
+            TRACE_ZONE("swap");
+            if (headless)
+            {
+                // nothing is presented: wait for the GPU so the frame time covers the whole frame
+                glFinish();
+                headlessFrameIndex++;
+            }
+            else
+            {
+                // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+                // -------------------------------------------------------------------------------
+                glfwSwapBuffers(window);
+                glfwPollEvents();
+            }
+        }
+        frameStats.EndPhase(PHASE_SWAP);
+        frameStats.EndFrame();
 
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+        framesSinceStatsReport++;
+        if (!headless && glfwGetTime() - lastStatsReportTime >= statsReportInterval)
+        {
+            frameStats.Print(std::cout, framesSinceStatsReport);
+            if (cpuCulling)
+                std::cout << "Frustum culling: " << frustumVisibleCount << " of " << cubeField.Count() << " objects in the frustum" << std::endl;
+            if (occlusionCulling)
+                std::cout << "Occlusion culling: " << occlusionCuller.HiddenCount() << " of those hidden, " << drawCount << " objects drawn" << std::endl;
+            stateCache.PrintCounters(std::cout, framesSinceStatsReport);
+            stateCache.ResetCounters();
+            framesSinceStatsReport = 0;
+            lastStatsReportTime = glfwGetTime();
         }
+    }
 
-        // also draw the lamp object
-        lampCubeShader.use();
-        lampCubeShader.setMat4("projectionMatrix", projectionMatrix);
-        lampCubeShader.setMat4("viewMatrix", viewMatrix);
-        modelMatrix = glm::mat4(1.0f);
-        modelMatrix = glm::translate(modelMatrix, lightAndLampPosition);
-        modelMatrix = glm::scale(modelMatrix, glm::vec3(0.2f)); // a smaller cube
-        lampCubeShader.setMat4("modelMatrix", modelMatrix);
-        
-        lampCubeShader.setVec3("lightCubeColor", 0.0, 0.0, 0.0);
-        
-        glBindVertexArray(lightCubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+    // the last frames' results: wait for the GPU once, the loop is over
+    glFinish();
+    gpuTimer->Collect(frameStats);
+    gpuTimer.reset();
+    frameUniforms.reset();
+    lightingUniforms.reset();
+    clusterUniforms.reset();
+    clusterLightBuffers.reset();
 
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    if (headless)
+    {
+        frameStats.Print(std::cout);
+        if (cpuCulling)
+            std::cout << "Frustum culling: " << frustumVisibleCount << " of " << cubeField.Count() << " objects in the frustum in the last frame" << std::endl;
+        if (occlusionCulling)
+            std::cout << "Occlusion culling: " << occlusionCuller.HiddenCount() << " of those hidden, " << frustumCuller.VisibleCount() << " objects drawn in the last frame" << std::endl;
+        if (depthPrepass)
+            std::cout << "Depth pre-pass: on" << std::endl;
+        stateCache.PrintCounters(std::cout, headlessFrameCount);
+        if (!outputPath.empty())
+        {
+            // last frame, flipped to top-down rows so it compares directly with the --software output
+            std::vector<unsigned char> pixels((size_t)framebufferWidth * framebufferHeight * 3);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, framebufferWidth, framebufferHeight, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+            std::vector<unsigned char> topDown(pixels.size());
+            const size_t rowSize = (size_t)framebufferWidth * 3;
+            for (unsigned int y = 0; y < framebufferHeight; y++)
+                std::memcpy(&topDown[y * rowSize], &pixels[(framebufferHeight - 1 - y) * rowSize], rowSize);
+            writePpm(outputPath, framebufferWidth, framebufferHeight, topDown.data());
+        }
+        offscreenFramebuffer.reset();
     }
+    if (!statsCsvPath.empty())
+        frameStats.WriteCsv(statsCsvPath);
+    if (!statsJsonPath.empty())
+        frameStats.WriteJson(statsJsonPath);
+#if ENABLE_TRACE_PROFILER
+    if (!tracePath.empty())
+        TraceProfiler::Write(tracePath);
+#endif
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
     glDeleteVertexArrays(1, &cubeVAO);
     glDeleteVertexArrays(1, &lightCubeVAO);
-    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &instanceVBO);
+    gpuCuller.reset();
+    depthPyramid.reset();
+    modelMesh.reset();
+    cubeMesh.reset();
+    glDeleteTextures(1, &diffuseMap);
+    glDeleteTextures(1, &specularMap);
+    textureStreamer.reset();
+    shaderManager.Clear();
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
@@ -372,50 +900,130 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
 
+// glfw: whenever a key is pressed, released or repeated, this callback is called
+// ------------------------------------------------------------------------------
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    if (key == GLFW_KEY_P && action == GLFW_PRESS)
+    {
+        depthPrepass = !depthPrepass;
+        std::cout << "Depth pre-pass " << (depthPrepass ? "on" : "off") << std::endl;
+    }
+}
+
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 // ---------------------------------------------------------------------------------------------
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
+    // a minimized window reports 0x0: keep the last real size so the aspect ratio never becomes 0/0
+    if (width == 0 || height == 0)
+        return;
+    framebufferWidth = (unsigned int)width;
+    framebufferHeight = (unsigned int)height;
+
     // make sure the viewport matches the new window dimensions; note that width and 
     // height will be significantly larger than specified on retina displays.
     glViewport(0, 0, width, height);
 }
 
-// utility function for loading a 2D texture from file
-// ---------------------------------------------------
-unsigned int loadTexture(char const* path)
+// micro-benchmark: uploads one model matrix per object, first the way the render loop used to
+// (std::string built from a literal + glGetUniformLocation per call), then through a UniformHandle
+// ---------------------------------------------------------------------------------------------------------
+void runUniformUploadBenchmark(const Shader& shader, unsigned int objectCount)
+{
+    const int benchmarkFrames = 100;
+    glUseProgram(shader.ID);
+
+    auto measure = [&](bool useHandles) {
+        glFinish();
+        double startTime = glfwGetTime();
+        for (int frame = 0; frame < benchmarkFrames; frame++)
+        {
+            for (unsigned int i = 0; i < objectCount; i++)
+            {
+                glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3((float)i, 0.0f, 0.0f));
+                if (useHandles)
+                {
+                    shader.setMat4(Uniforms::modelViewMatrix, model);
+                }
+                else
+                {
+                    const std::string name = "modelViewMatrix";
+                    glUniformMatrix4fv(glGetUniformLocation(shader.ID, name.c_str()), 1, GL_FALSE, &model[0][0]);
+                }
+            }
+        }
+        glFinish();
+        return (glfwGetTime() - startTime) * 1000.0 / benchmarkFrames;
+    };
+
+    // warm up the driver once before measuring
+    measure(true);
+    double stringLookupTime = measure(false);
+    double handleTime = measure(true);
+
+    std::cout << "Uniform upload, " << objectCount << " objects, average over " << benchmarkFrames << " frames:" << std::endl;
+    std::cout << "  string + glGetUniformLocation: " << stringLookupTime << " ms/frame" << std::endl;
+    std::cout << "  UniformHandle:                 " << handleTime << " ms/frame" << std::endl;
+    if (handleTime > 0.0)
+        std::cout << "  speedup: " << stringLookupTime / handleTime << "x" << std::endl;
+}
+
+// headless benchmark: fixed camera path orbiting the scene, so every run renders exactly the same frames
+// ---------------------------------------------------------------------------------------------------------
+void applyBenchmarkCameraPath(unsigned int frameIndex, unsigned int frameCount)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    const float pathRadius = 7.0f;
+    const glm::vec3 pathCenter(0.0f, 0.0f, -3.0f);
+
+    float t = frameCount > 1 ? (float)frameIndex / (float)(frameCount - 1) : 0.0f;
+    float pathAngle = t * glm::two_pi<float>();
+    camera.Position = pathCenter + glm::vec3(sin(pathAngle) * pathRadius, 1.5f * sin(2.0f * pathAngle), cos(pathAngle) * pathRadius);
+
+    // look at the center of the path
+    glm::vec3 toCenter = glm::normalize(pathCenter - camera.Position);
+    float yaw = glm::degrees(atan2(toCenter.z, toCenter.x));
+    float pitch = glm::degrees(asin(toCenter.y));
+    camera.SetOrientation(yaw, pitch);
+}
 
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
+// renders the headless benchmark frames on the CPU with the SoftwareRasterizer; the last frame can be saved as a PPM image
+// ---------------------------------------------------------------------------------------------------------
+int runSoftwareRenderer(unsigned int frameCount, unsigned int cubeCount, const std::string& outputPath)
+{
+    WorkerPool pool;
+    SoftwareRasterizer rasterizer((int)framebufferWidth, (int)framebufferHeight, pool);
+    if (!rasterizer.LoadTextures("container2.png", "container2_specular.png"))
+        return -1;
+    CubeField cubeField(cubeCount);
+    rasterizer.SetObjects(cubeField);
+    const NegativeLightProperties negativeLight = sceneNegativeLight();
+
+    std::cout << "Software renderer: " << frameCount << " frames at " << framebufferWidth << "x" << framebufferHeight
+        << ", " << cubeField.Count() << " cubes, " << pool.ThreadCount() << " threads, " << FloatLanes::Count << " lanes" << std::endl;
+
+    FrameStats frameStats(std::max<size_t>(frameCount, 1));
+    for (unsigned int frameIndex = 0; frameIndex < frameCount; frameIndex++)
     {
-        GLenum format{};
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
+        // same camera path and simulated time as the headless GL benchmark
+        applyBenchmarkCameraPath(frameIndex, frameCount);
+        glm::vec3 lightPosition = orbitingLightPosition(frameIndex * headlessFrameTimeStep);
+        glm::mat4 projectionMatrix = glm::perspective(glm::radians(camera.FieldOfView), (float)framebufferWidth / (float)framebufferHeight, NEAR_PLANE, FAR_PLANE);
+
+        frameStats.BeginFrame();
+        rasterizer.RenderFrame(projectionMatrix, camera.GetViewMatrix(), lightPosition, negativeLight);
+        frameStats.EndFrame();
     }
-    else
+
+    TimingSummary frame = frameStats.SummarizeFrames();
+    if (frame.Samples > 0)
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        std::cout << "Frame time over " << frame.Samples << " frames (ms): min " << frame.Min << ", avg " << frame.Average
+            << ", p50 " << frame.P50 << ", p95 " << frame.P95 << ", p99 " << frame.P99 << ", max " << frame.Max << std::endl;
+        std::cout << "Throughput: " << framebufferWidth * (double)framebufferHeight / (frame.Average * 1000.0) << " Mpixel/s, "
+            << rasterizer.TriangleCount() << " triangles in the last frame" << std::endl;
     }
-
-    return textureID;
-}
\ No newline at end of file
+    if (!outputPath.empty() && frameCount > 0)
+        writePpm(outputPath, rasterizer.Width(), rasterizer.Height(), rasterizer.Pixels().data());
+    return 0;
+}
@@ -0,0 +1,6 @@
+#version 330 core
+// depth pre-pass: no color output, the rasterizer writes the depth of the cube vertex shader's gl_Position
+
+void main()
+{
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#version 330 core
+// one texel of a depth pyramid level: the farthest depth of the 2x2 source texels it covers,
+// 3 wide or tall on the last column or row when the source size is odd
+uniform sampler2D sourceDepth; // the previous level, or the depth buffer copy
+
+out float FarthestDepth;
+
+void main()
+{
+    ivec2 sourceSize = textureSize(sourceDepth, 0);
+    ivec2 outputSize = max(sourceSize / 2, ivec2(1));
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    ivec2 first = texel * 2;
+    ivec2 end = min(first + 2, sourceSize);
+    if (texel.x == outputSize.x - 1)
+        end.x = sourceSize.x;
+    if (texel.y == outputSize.y - 1)
+        end.y = sourceSize.y;
+
+    float farthest = 0.0;
+    for (int y = first.y; y < end.y; y++)
+    {
+        for (int x = first.x; x < end.x; x++)
+            farthest = max(farthest, texelFetch(sourceDepth, ivec2(x, y), 0).r);
+    }
+    FarthestDepth = farthest;
+}
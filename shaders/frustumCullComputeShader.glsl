@@ -0,0 +1,43 @@
+#version 430 core
+// one object per invocation: GpuCuller::WorkgroupSize
+layout (local_size_x = 64) in;
+
+// world-space bounding spheres: center in xyz, radius in w
+layout (std430, binding = 0) readonly buffer ObjectBounds
+{
+    vec4 objectBounds[];
+};
+
+layout (std430, binding = 2) writeonly buffer VisibleObjects
+{
+    uint visibleObjects[];
+};
+
+// the DrawElementsIndirectCommand of the draw; instanceCount is reset to 0 before the dispatch
+layout (std430, binding = 3) buffer DrawCommand
+{
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+// left, right, bottom, top, near, far, normalized: dot(plane.xyz, point) + plane.w is a signed distance
+uniform vec4 frustumPlanes[6];
+uniform int objectCount;
+
+void main()
+{
+    uint object = gl_GlobalInvocationID.x;
+    if (object >= uint(objectCount))
+        return;
+
+    vec4 sphere = objectBounds[object];
+    for (int plane = 0; plane < 6; plane++)
+    {
+        if (dot(frustumPlanes[plane].xyz, sphere.xyz) + frustumPlanes[plane].w < -sphere.w)
+            return;
+    }
+    visibleObjects[atomicAdd(instanceCount, 1u)] = object;
+}
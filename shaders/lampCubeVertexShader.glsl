@@ -2,8 +2,15 @@
 layout (location = 0) in vec3 positionAttribute;
 
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
+
+// per-frame data, shared by every program through the uniform buffer bound to FRAME_UNIFORMS_BINDING
+layout (std140) uniform FrameUniforms
+{
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    vec3 viewPosition;
+    vec3 lightPosition; // world space
+};
 
 void main()
 {
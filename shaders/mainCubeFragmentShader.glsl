@@ -11,7 +11,6 @@ struct Material {
     sampler2D diffuseMap;
     sampler2D specularMap;
     sampler2D emissionMap;
-    float     shininess;
 }; 
   
 uniform Material material;
@@ -28,7 +27,54 @@ struct LightProperties {
     float attenuationQuadraticTerm;
 };
 
-uniform LightProperties lightProperties;  
+// light and material constants, uploaded once through the uniform buffer bound to LIGHTING_UNIFORMS_BINDING
+layout (std140) uniform LightingUniforms
+{
+    LightProperties lightProperties;
+    float materialShininess; // samplers cannot live in a block, the shininess left the Material struct
+};
+
+// clustered point lights: the froxel grid built on the CPU by LightClusterGrid, bound to CLUSTER_UNIFORMS_BINDING
+layout (std140) uniform ClusterUniforms
+{
+    uvec4 clusterGridSize;  // x, y, z: froxel counts, w: number of point lights
+    vec4 clusterParameters; // x, y: slice = log(depth) * x + y, z, w: screen tile size in pixels
+};
+uniform usamplerBuffer clusterRecords;      // per froxel: first index in clusterLightIndices, light count
+uniform usamplerBuffer clusterLightIndices;
+uniform samplerBuffer pointLights;          // per light: view-space position and radius, then color (negative for negative lights)
+
+// sum of the point lights of the fragment's froxel, signed: negative lights remove their contribution
+vec3 clusteredPointLights(vec3 viewDirection, vec3 diffuseTexel, vec3 specularTexel)
+{
+    int slice = clamp(int(log(-FragmentPosition.z) * clusterParameters.x + clusterParameters.y), 0, int(clusterGridSize.z) - 1);
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterParameters.zw), clusterGridSize.xy - 1u);
+    int cluster = int(tile.x + clusterGridSize.x * (tile.y + clusterGridSize.y * uint(slice)));
+    uvec2 record = texelFetch(clusterRecords, cluster).xy;
+
+    vec3 color = vec3(0.0);
+    for (uint i = 0u; i < record.y; i++)
+    {
+        int lightIndex = int(texelFetch(clusterLightIndices, int(record.x + i)).r);
+        vec4 positionRadius = texelFetch(pointLights, 2 * lightIndex);
+        vec3 signedColor = texelFetch(pointLights, 2 * lightIndex + 1).rgb;
+
+        vec3 toLight = positionRadius.xyz - FragmentPosition;
+        float lightDistance = length(toLight);
+        vec3 lightDirection = toLight / lightDistance;
+        float diffuseQuantity = max(dot(NormalVector, lightDirection), 0.0);
+        float specularPower = pow(max(dot(viewDirection, reflect(-lightDirection, NormalVector)), 0.0), materialShininess);
+        // the scene attenuation, faded out to exactly 0 at the light radius so the froxel lists are exact
+        float attenuation = 1.0 / (lightProperties.attenuationConstantTerm
+            + lightProperties.attenuationLinearTerm * lightDistance
+            + lightProperties.attenuationQuadraticTerm * (lightDistance * lightDistance));
+        float window = clamp(1.0 - pow(lightDistance / positionRadius.w, 4.0), 0.0, 1.0);
+        attenuation *= window * window;
+
+        color += signedColor * (diffuseQuantity * diffuseTexel + specularPower * specularTexel) * attenuation;
+    }
+    return color;
+}
 
 void main()
 {
@@ -56,7 +102,7 @@ void main()
     */
     vec3 viewDirection = normalize(/* (0,0,0) */ - FragmentPosition);
     vec3 reflectDirection = reflect(-lightDirection, NormalVector);  
-    float specularPower = pow(max(dot(viewDirection, reflectDirection), 0.0), material.shininess);
+    float specularPower = pow(max(dot(viewDirection, reflectDirection), 0.0), materialShininess);
     vec3 specularMap = texture(material.specularMap, TextureCoordinates).rgb;
     vec3 specularColor = lightProperties.specular * specularPower * specularMap;
 
@@ -75,5 +121,6 @@ void main()
     By replacing the "+" by "-", we make this "negative light".
     We SUBSTRACT the diffuseColor and specularColor from the ambientColor.
     */
-    FragmentColor = vec4(ambientColor - diffuseColor - specularColor, 1.0);
+    vec3 pointLightColor = clusteredPointLights(viewDirection, texture(material.diffuseMap, TextureCoordinates).rgb, specularMap);
+    FragmentColor = vec4(ambientColor - diffuseColor - specularColor + pointLightColor, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+#version 430 core
+layout (location = 0) in vec3 positionAttribute;
+layout (location = 1) in vec3 normalVectorAttribute;
+layout (location = 2) in vec2 textureCoordinatesAttribute;
+
+out vec3 FragmentPosition; 
+out vec3 NormalVector;
+out vec3 LightPosition;
+out vec2 TextureCoordinates;
+
+// see the depth pre-pass setup in negative-light-opengl.cpp
+invariant gl_Position;
+
+// per-frame data, shared by every program through the uniform buffer bound to FRAME_UNIFORMS_BINDING
+layout (std140) uniform FrameUniforms
+{
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    vec3 viewPosition;
+    vec3 lightPosition; // world space
+};
+
+// world matrices of every object, uploaded once (GpuCuller::GpuObjectTransform)
+struct ObjectTransform
+{
+    mat4 modelMatrix;
+    mat3 normalMatrix; // inverse-transpose of the model matrix's upper 3x3
+};
+layout (std430, binding = 1) readonly buffer ObjectTransforms
+{
+    ObjectTransform objectTransforms[];
+};
+
+// the objects frustumCullComputeShader.glsl kept this frame, one per instance
+layout (std430, binding = 2) readonly buffer VisibleObjects
+{
+    uint visibleObjects[];
+};
+
+void main()
+{
+    ObjectTransform object = objectTransforms[visibleObjects[gl_InstanceID]];
+    vec4 viewSpacePosition = viewMatrix * object.modelMatrix * vec4(positionAttribute, 1.0);
+    gl_Position = projectionMatrix * viewSpacePosition;
+
+    FragmentPosition = vec3(viewSpacePosition);
+    // the view matrix is a rigid transform: its rotation part times the world-space normal matrix
+    NormalVector = normalize(mat3(viewMatrix) * object.normalMatrix * normalVectorAttribute);
+    LightPosition = vec3(viewMatrix * vec4(lightPosition, 1.0));
+    TextureCoordinates = textureCoordinatesAttribute;
+
+}
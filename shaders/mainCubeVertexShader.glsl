@@ -8,23 +8,37 @@ out vec3 NormalVector;
 out vec3 LightPosition;
 out vec2 TextureCoordinates;
 
+// see the depth pre-pass setup in negative-light-opengl.cpp
+invariant gl_Position;
+
  /**
   We define the uniform lightPosition in the vertex shader, 
   and pass the 'view space' lightPosition to the fragment shader. 
   lightPosition is currently in world space.
  */
-uniform vec3 lightPosition; 
+// per-frame data, shared by every program through the uniform buffer bound to FRAME_UNIFORMS_BINDING
+layout (std140) uniform FrameUniforms
+{
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    vec3 viewPosition;
+    vec3 lightPosition; // world space
+};
 
-uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
+/**
+  modelViewMatrix and normalMatrix are computed once per object on the CPU,
+  instead of evaluating transpose(inverse(viewMatrix * modelMatrix)) for every vertex.
+*/
+uniform mat4 modelViewMatrix;
+uniform mat3 normalMatrix;
 
 void main()
 {
-    gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(positionAttribute, 1.0);
+    vec4 viewSpacePosition = modelViewMatrix * vec4(positionAttribute, 1.0);
+    gl_Position = projectionMatrix * viewSpacePosition;
 
-    FragmentPosition = vec3(viewMatrix * modelMatrix * vec4(positionAttribute, 1.0));
-    NormalVector = normalize(mat3(transpose(inverse(viewMatrix * modelMatrix))) * normalVectorAttribute);  
+    FragmentPosition = vec3(viewSpacePosition);
+    NormalVector = normalize(normalMatrix * normalVectorAttribute);  
     LightPosition = vec3(viewMatrix * vec4(lightPosition, 1.0)); // Transform world-space light position to view-space light position
     TextureCoordinates = textureCoordinatesAttribute;
 
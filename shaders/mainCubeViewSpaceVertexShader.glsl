@@ -0,0 +1,37 @@
+#version 330 core
+layout (location = 0) in vec3 positionAttribute;
+layout (location = 1) in vec3 normalVectorAttribute;
+layout (location = 2) in vec2 textureCoordinatesAttribute;
+// per-instance attributes (divisor 1), computed every frame by the CPU transform stage:
+// a mat4 takes locations 3 to 6, a mat3 locations 7 to 9
+layout (location = 3) in mat4 instanceModelViewMatrix;
+layout (location = 7) in mat3 instanceNormalMatrix;
+
+out vec3 FragmentPosition; 
+out vec3 NormalVector;
+out vec3 LightPosition;
+out vec2 TextureCoordinates;
+
+// see the depth pre-pass setup in negative-light-opengl.cpp
+invariant gl_Position;
+
+// per-frame data, shared by every program through the uniform buffer bound to FRAME_UNIFORMS_BINDING
+layout (std140) uniform FrameUniforms
+{
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    vec3 viewPosition;
+    vec3 lightPosition; // world space
+};
+
+void main()
+{
+    vec4 viewSpacePosition = instanceModelViewMatrix * vec4(positionAttribute, 1.0);
+    gl_Position = projectionMatrix * viewSpacePosition;
+
+    FragmentPosition = vec3(viewSpacePosition);
+    NormalVector = normalize(instanceNormalMatrix * normalVectorAttribute);
+    LightPosition = vec3(viewMatrix * vec4(lightPosition, 1.0));
+    TextureCoordinates = textureCoordinatesAttribute;
+
+}